@@ -0,0 +1,139 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "AdaptiveSolver.h"
+#include "Exercise.h"
+#include "Profiler.h"
+#include <algorithm>
+
+using namespace BogackiShampine;
+
+void AdaptiveRKSolver::Evaluate(ParticleSystem &ps, double d, int stage)
+{
+	{
+		PROFILE_SCOPE("Forces");
+		ps.ClearForces();
+		ps.AddSpringForces();
+		ps.AddDampingForces(d);
+		ps.AddGroundPenalty(groundHeight, groundStiffness);
+	}
+	ps.AddContactForces();
+
+	const int n = ps.ParticleCount();
+	for (int i = 0; i < n; i++)
+	{
+		const double w = ps.invMass[i];
+		kx[stage][i] = ps.vx[i];
+		ky[stage][i] = ps.vy[i];
+		kvx[stage][i] = w * ps.fx[i];
+		// gravity is an acceleration, fixed particles stay at rest
+		kvy[stage][i] = (w == 0.0) ? 0.0 : w * ps.fy[i] - gravity;
+	}
+}
+
+void AdaptiveRKSolver::SetStage(ParticleSystem &ps, double h, const double *w, int stages)
+{
+	const int n = ps.ParticleCount();
+	for (int i = 0; i < n; i++)
+	{
+		double dx = 0.0, dy = 0.0, dvx = 0.0, dvy = 0.0;
+		for (int s = 0; s < stages; s++)
+		{
+			dx += w[s] * kx[s][i];
+			dy += w[s] * ky[s][i];
+			dvx += w[s] * kvx[s][i];
+			dvy += w[s] * kvy[s][i];
+		}
+		ps.x[i] = x0[i] + h * dx;
+		ps.y[i] = y0[i] + h * dy;
+		ps.vx[i] = vx0[i] + h * dvx;
+		ps.vy[i] = vy0[i] + h * dvy;
+	}
+}
+
+double AdaptiveRKSolver::ErrorNorm(const ParticleSystem &ps, double h) const
+{
+	const int n = ps.ParticleCount();
+	if (n == 0)
+		return 0.0;
+
+	double sum = 0.0;
+	for (int i = 0; i < n; i++)
+	{
+		const double err[4] = {
+			h * (e1 * kx[0][i] + e2 * kx[1][i] + e3 * kx[2][i] + e4 * kx[3][i]),
+			h * (e1 * ky[0][i] + e2 * ky[1][i] + e3 * ky[2][i] + e4 * ky[3][i]),
+			h * (e1 * kvx[0][i] + e2 * kvx[1][i] + e3 * kvx[2][i] + e4 * kvx[3][i]),
+			h * (e1 * kvy[0][i] + e2 * kvy[1][i] + e3 * kvy[2][i] + e4 * kvy[3][i]) };
+		const double start[4] = { x0[i], y0[i], vx0[i], vy0[i] };
+		const double end[4] = { ps.x[i], ps.y[i], ps.vx[i], ps.vy[i] };
+		for (int c = 0; c < 4; c++)
+		{
+			double scale = atol + rtol * std::max(fabs(start[c]), fabs(end[c]));
+			sum += (err[c] / scale) * (err[c] / scale);
+		}
+	}
+	return sqrt(sum / (4.0 * n));
+}
+
+void AdaptiveRKSolver::Advance(ParticleSystem &ps, double d, double interval)
+{
+	if (interval <= 0.0)
+		return;
+
+	const int n = ps.ParticleCount();
+	x0 = ps.x; y0 = ps.y;
+	vx0 = ps.vx; vy0 = ps.vy;
+	for (int s = 0; s < 4; s++)
+	{
+		kx[s].resize(n); ky[s].resize(n);
+		kvx[s].resize(n); kvy[s].resize(n);
+	}
+
+	// the first stage of every later step is the last stage of the step
+	// before it
+	Evaluate(ps, d, 0);
+	if (h <= 0.0)
+		h = interval;
+
+	const double w2[1] = { a21 };
+	const double w3[2] = { 0.0, a32 };
+	const double w4[3] = { b1, b2, b3 };
+	double t = 0.0;
+	while (t < interval)
+	{
+		// the last step ends exactly at the interval
+		const bool last = (t + h >= interval);
+		const double step = last ? interval - t : h;
+
+		SetStage(ps, step, w2, 1);
+		Evaluate(ps, d, 1);
+		SetStage(ps, step, w3, 2);
+		Evaluate(ps, d, 2);
+		SetStage(ps, step, w4, 3);
+		Evaluate(ps, d, 3);
+
+		const double norm = ErrorNorm(ps, step);
+		const double next = NextStep(step, norm);
+		if (norm <= 1.0 || step <= minStep)
+		{
+			accepted++;
+			t = last ? interval : t + step;
+			x0 = ps.x; y0 = ps.y;
+			vx0 = ps.vx; vy0 = ps.vy;
+			std::swap(kx[0], kx[3]); std::swap(ky[0], ky[3]);
+			std::swap(kvx[0], kvx[3]); std::swap(kvy[0], kvy[3]);
+			// a step shortened to hit the interval end does not shrink the
+			// proposal for the next interval
+			if (!last || next > h)
+				h = next;
+		}
+		else
+		{
+			rejected++;
+			h = std::max(next, minStep);
+		}
+	}
+}
@@ -0,0 +1,74 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <vector>
+#include <math.h>
+#include "ParticleSystem.h"
+
+// Bogacki-Shampine 3(2) embedded Runge-Kutta pair. The third-order solution
+// is propagated, the difference to the second-order one estimates the local
+// error. The last stage is the derivative at the new state, so an accepted
+// step hands it to the next step as its first stage (FSAL).
+namespace BogackiShampine
+{
+	const double c2 = 0.5, c3 = 0.75;
+	const double a21 = 0.5;
+	const double a32 = 0.75;
+	// third-order weights, also the last stage row
+	const double b1 = 2.0 / 9.0, b2 = 1.0 / 3.0, b3 = 4.0 / 9.0;
+	// third minus second-order weights
+	const double e1 = -5.0 / 72.0, e2 = 1.0 / 12.0, e3 = 1.0 / 9.0, e4 = -1.0 / 8.0;
+	// steps this short are accepted whatever their error
+	const double minStep = 1e-12;
+
+	// Next step size for the error norm of a step of size h (accepted for
+	// norm <= 1). The growth stays bounded and a rejected step only shrinks.
+	inline double NextStep(double h, double norm)
+	{
+		// NaN norms shrink like very large ones
+		double factor = (norm > 0.0) ? 0.9 * pow(norm, -1.0 / 3.0) : (norm == 0.0) ? 5.0 : 0.2;
+		factor = (factor < 0.2) ? 0.2 : (factor > 5.0) ? 5.0 : factor;
+		if (norm > 1.0 && factor > 1.0)
+			factor = 1.0;
+		return h * factor;
+	}
+}
+
+// Error-controlled integration of a spring network with the Bogacki-Shampine
+// pair. Advance() covers the requested interval with as many steps as the
+// tolerances require; the step size carries over between calls, so quiet
+// phases take steps as long as the interval.
+class AdaptiveRKSolver
+{
+public:
+	// Error tolerance per component: atol + rtol * |value|
+	double rtol, atol;
+	// Proposed size of the next step, 0 picks one from the interval
+	double h;
+	// Step statistics since the last Scene::Init or Reset, which zero them
+	long accepted, rejected;
+
+	AdaptiveRKSolver(void) : rtol(1e-6), atol(1e-9), h(0.0), accepted(0), rejected(0) {}
+
+	void Advance(ParticleSystem &ps, double d, double interval);
+
+private:
+	// Stage derivatives at the positions and velocities currently in ps
+	void Evaluate(ParticleSystem &ps, double d, int stage);
+	// Writes the start state plus h * sum(w[s] * k[s]) over the first stages
+	// into ps
+	void SetStage(ParticleSystem &ps, double h, const double *w, int stages);
+	// Weighted RMS norm of the error estimate of a step of size h from the
+	// start state to the state in ps
+	double ErrorNorm(const ParticleSystem &ps, double h) const;
+
+	// state at the start of the step
+	std::vector<double> x0, y0, vx0, vy0;
+	// stages: velocities are the position derivatives, accelerations the
+	// velocity derivatives
+	std::vector<double> kx[4], ky[4], kvx[4], kvy[4];
+};
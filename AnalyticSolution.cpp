@@ -0,0 +1,205 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "AnalyticSolution.h"
+#include "Exercise.h"
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+
+AnalyticSolution::AnalyticSolution(void)
+	: regime(INVALID), k(0), m(0), d(0), L(0), p1(0), x0(0), v0(0),
+	a(0), b(0), offset(0), c1(0), c2(0), e1(0), e2(0)
+{
+}
+
+AnalyticSolution::AnalyticSolution(double _k, double _m, double _d, double _L, double _p1, double _x0, double _v0)
+	: k(_k), m(_m), d(_d), L(_L), p1(_p1), x0(_x0), v0(_v0)
+{
+	double tmp = d * d - 4 * k * m;
+	double div = 2 * m;
+	b = d / div;
+	// rest position
+	offset = -gravity * m / k - L + p1;
+	double y0 = x0 - offset;
+
+	if (tmp < 0)
+	{
+		regime = UNDERDAMPED;
+		a = sqrt(-tmp) / div;
+		c1 = y0;
+		c2 = (v0 + b * y0) / a;
+		e1 = v0;
+		e2 = -(b * c2 + a * c1);
+	}
+	else if (tmp == 0)
+	{
+		regime = CRITICAL;
+		a = 0;
+		c1 = y0;
+		c2 = v0 + b * y0;
+		// v(t) = e^(-b t) (e1 + e2 t)
+		e1 = c2 - b * c1;
+		e2 = -b * c2;
+	}
+	else
+	{
+		regime = OVERDAMPED;
+		a = sqrt(tmp) / div;
+		c2 = (v0 + (a + b) * y0) / (2 * a);
+		c1 = y0 - c2;
+		e1 = -(a + b) * c1;
+		e2 = (a - b) * c2;
+	}
+}
+
+bool AnalyticSolution::Matches(double _k, double _m, double _d, double _L, double _p1, double _x0, double _v0) const
+{
+	return regime != INVALID && k == _k && m == _m && d == _d && L == _L && p1 == _p1 && x0 == _x0 && v0 == _v0;
+}
+
+void AnalyticSolution::Evaluate(double t, double &p, double &v) const
+{
+	switch (regime)
+	{
+	case UNDERDAMPED:
+	{
+		double e = exp(-b * t), c = cos(a * t), s = sin(a * t);
+		p = e * (c1 * c + c2 * s) + offset;
+		v = e * (e1 * c + e2 * s);
+		break;
+	}
+	case CRITICAL:
+	{
+		double e = exp(-b * t);
+		p = e * (c1 + c2 * t) + offset;
+		v = e * (e1 + e2 * t);
+		break;
+	}
+	case OVERDAMPED:
+	{
+		double f = exp(-(a + b) * t), g = exp((a - b) * t);
+		p = c1 * f + c2 * g + offset;
+		v = e1 * f + e2 * g;
+		break;
+	}
+	default:
+		p = x0;
+		v = v0;
+		break;
+	}
+}
+
+// Branch-free exp and sincos (Cephes coefficients) so that the loops below
+// are turned into vector code by the compiler.
+
+static inline double BatchExp(double x)
+{
+	const double LOG2E = 1.4426950408889634073599;
+	const double C1 = 6.93145751953125E-1;
+	const double C2 = 1.42860682030941723212E-6;
+
+	// Results below 2^-1022 or above 2^1023 are not needed here
+	x = x < -708.0 ? -708.0 : x;
+	x = x > 709.0 ? 709.0 : x;
+
+	// x = n ln2 + r, |r| <= ln2 / 2. Adding 1.5 * 2^52 rounds to the nearest
+	// integer and leaves n in the low mantissa bits.
+	const double SHIFTER = 6755399441055744.0;
+	double kd = LOG2E * x + SHIFTER;
+	double n = kd - SHIFTER;
+	double r = x - n * C1;
+	r = r - n * C2;
+
+	// e^r = 1 + 2 r P(r^2) / (Q(r^2) - r P(r^2))
+	double rr = r * r;
+	double pr = r * ((1.26177193074810590878E-4 * rr + 3.02994407707441961300E-2) * rr + 9.99999999999999999910E-1);
+	double qr = ((3.00198505138664455042E-6 * rr + 2.52448340349684104192E-3) * rr + 2.27265548208155028766E-1) * rr + 2.00000000000000000009E0;
+	double er = 1.0 + 2.0 * pr / (qr - pr);
+
+	// 2^n from the exponent bits
+	uint64_t bits;
+	memcpy(&bits, &kd, sizeof(bits));
+	bits = (bits - 0x4338000000000000ULL + 1023) << 52;
+	double scale;
+	memcpy(&scale, &bits, sizeof(scale));
+	return er * scale;
+}
+
+static inline void BatchSinCos(double x, double &s, double &c)
+{
+	const double TWOOPI = 6.36619772367581343076E-1;
+	const double SHIFTER = 6755399441055744.0;
+	const double PIO2_1 = 1.57079625129699707031E0;
+	const double PIO2_2 = 7.54978941586159635335E-8;
+	const double PIO2_3 = 5.39030285815811905290E-15;
+
+	// x = j pi/2 + z with |z| <= pi/4, the quadrant j mod 4 is taken from the
+	// low mantissa bits of the rounded value
+	double kd = x * TWOOPI + SHIFTER;
+	double j = kd - SHIFTER;
+	uint64_t q;
+	memcpy(&q, &kd, sizeof(q));
+	q &= 3;
+	double z = ((x - j * PIO2_1) - j * PIO2_2) - j * PIO2_3;
+	double zz = z * z;
+
+	double ps = z + z * zz * (((((1.58962301576546568060E-10 * zz - 2.50507477628578072866E-8) * zz
+		+ 2.75573136213857245213E-6) * zz - 1.98412698295895385996E-4) * zz
+		+ 8.33333333332211858878E-3) * zz - 1.66666666666666307295E-1);
+	double pc = 1.0 - 0.5 * zz + zz * zz * (((((-1.13585365213876817300E-11 * zz + 2.08757008419747316778E-9) * zz
+		- 2.75573141792967388112E-7) * zz + 2.48015872888517045348E-5) * zz
+		- 1.38888888888730564116E-3) * zz + 4.16666666666665929218E-2);
+
+	// q = 0: ( s,  c), 1: ( c, -s), 2: (-s, -c), 3: (-c,  s)
+	double rs = (q & 1) ? pc : ps;
+	double rc = (q & 1) ? ps : pc;
+	s = (q & 2) ? -rs : rs;
+	c = ((q + 1) & 2) ? -rc : rc;
+}
+
+void AnalyticSolution::Evaluate(const double *t, double *p, double *v, int n) const
+{
+	const double a = this->a, b = this->b, offset = this->offset;
+	const double c1 = this->c1, c2 = this->c2, e1 = this->e1, e2 = this->e2;
+
+	switch (regime)
+	{
+	case UNDERDAMPED:
+		for (int i = 0; i < n; i++)
+		{
+			double e = BatchExp(-b * t[i]);
+			double s, c;
+			BatchSinCos(a * t[i], s, c);
+			p[i] = e * (c1 * c + c2 * s) + offset;
+			v[i] = e * (e1 * c + e2 * s);
+		}
+		break;
+	case CRITICAL:
+		for (int i = 0; i < n; i++)
+		{
+			double e = BatchExp(-b * t[i]);
+			p[i] = e * (c1 + c2 * t[i]) + offset;
+			v[i] = e * (e1 + e2 * t[i]);
+		}
+		break;
+	case OVERDAMPED:
+		for (int i = 0; i < n; i++)
+		{
+			double f = BatchExp(-(a + b) * t[i]);
+			double g = BatchExp((a - b) * t[i]);
+			p[i] = c1 * f + c2 * g + offset;
+			v[i] = e1 * f + e2 * g;
+		}
+		break;
+	default:
+		for (int i = 0; i < n; i++)
+		{
+			p[i] = x0;
+			v[i] = v0;
+		}
+		break;
+	}
+}
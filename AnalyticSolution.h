@@ -0,0 +1,46 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+// Closed-form solution of the damped hanging mass point (Exercise 1).
+// The coefficients only depend on the parameters and the initial state, so
+// they are computed once in the constructor and reused for every evaluation.
+class AnalyticSolution
+{
+public:
+	// Invalid solution, Matches() is false for all parameters
+	AnalyticSolution(void);
+	/** @param: k, m, d, L	stiffness, mass, damping, rest length
+	  * @param: p1		position of the fixed point
+	  * @param: x0, v0	position and velocity at time 0
+	  */
+	AnalyticSolution(double k, double m, double d, double L, double p1, double x0, double v0);
+
+	// True if the solution was set up for exactly these parameters
+	bool Matches(double k, double m, double d, double L, double p1, double x0, double v0) const;
+
+	// Position and velocity at time t
+	void Evaluate(double t, double &p, double &v) const;
+	// Position and velocity at n time points in one vectorized pass. Uses
+	// polynomial exp/sin/cos kernels that agree with the scalar version to
+	// about 1e-15 relative to the amplitude.
+	void Evaluate(const double *t, double *p, double *v, int n) const;
+
+private:
+	enum Regime { INVALID, UNDERDAMPED, CRITICAL, OVERDAMPED };
+	Regime regime;
+
+	// Parameters the solution was built for
+	double k, m, d, L, p1, x0, v0;
+
+	// x(t) = e^(-b t) (c1 cos(a t) + c2 sin(a t)) + offset		underdamped
+	// x(t) = e^(-b t) (c1 + c2 t) + offset						critical
+	// x(t) = c1 e^(-(b + a) t) + c2 e^((a - b) t) + offset		overdamped
+	// v(t) analogously with the coefficients e1, e2
+	double a, b, offset;
+	double c1, c2;
+	double e1, e2;
+};
@@ -0,0 +1,138 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "Ensemble.h"
+#include "Exercise.h"
+#include "Scene.h"
+#include "Integrators.h"
+
+#if defined(__AVX512F__) || defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ENSEMBLE_SSE2
+#endif
+
+// One double per lane, used for the remainder of the arrays
+struct Lanes1
+{
+	enum { Width = 1 };
+	double v;
+
+	Lanes1() {}
+	Lanes1(double s) : v(s) {}
+	static Lanes1 load(const double *p) { return Lanes1(*p); }
+	void store(double *p) const { *p = v; }
+	friend Lanes1 operator+(Lanes1 a, Lanes1 b) { return Lanes1(a.v + b.v); }
+	friend Lanes1 operator-(Lanes1 a, Lanes1 b) { return Lanes1(a.v - b.v); }
+	friend Lanes1 operator*(Lanes1 a, Lanes1 b) { return Lanes1(a.v * b.v); }
+	friend Lanes1 operator/(Lanes1 a, Lanes1 b) { return Lanes1(a.v / b.v); }
+	friend Lanes1 operator-(Lanes1 a) { return Lanes1(-a.v); }
+};
+
+// Widest vector type the compiler targets
+#if defined(__AVX512F__)
+struct LanesN
+{
+	enum { Width = 8 };
+	__m512d v;
+
+	LanesN() {}
+	LanesN(__m512d x) : v(x) {}
+	LanesN(double s) : v(_mm512_set1_pd(s)) {}
+	static LanesN load(const double *p) { return LanesN(_mm512_loadu_pd(p)); }
+	void store(double *p) const { _mm512_storeu_pd(p, v); }
+	friend LanesN operator+(LanesN a, LanesN b) { return LanesN(_mm512_add_pd(a.v, b.v)); }
+	friend LanesN operator-(LanesN a, LanesN b) { return LanesN(_mm512_sub_pd(a.v, b.v)); }
+	friend LanesN operator*(LanesN a, LanesN b) { return LanesN(_mm512_mul_pd(a.v, b.v)); }
+	friend LanesN operator/(LanesN a, LanesN b) { return LanesN(_mm512_div_pd(a.v, b.v)); }
+	friend LanesN operator-(LanesN a) { return LanesN(_mm512_sub_pd(_mm512_setzero_pd(), a.v)); }
+};
+#elif defined(__AVX__)
+struct LanesN
+{
+	enum { Width = 4 };
+	__m256d v;
+
+	LanesN() {}
+	LanesN(__m256d x) : v(x) {}
+	LanesN(double s) : v(_mm256_set1_pd(s)) {}
+	static LanesN load(const double *p) { return LanesN(_mm256_loadu_pd(p)); }
+	void store(double *p) const { _mm256_storeu_pd(p, v); }
+	friend LanesN operator+(LanesN a, LanesN b) { return LanesN(_mm256_add_pd(a.v, b.v)); }
+	friend LanesN operator-(LanesN a, LanesN b) { return LanesN(_mm256_sub_pd(a.v, b.v)); }
+	friend LanesN operator*(LanesN a, LanesN b) { return LanesN(_mm256_mul_pd(a.v, b.v)); }
+	friend LanesN operator/(LanesN a, LanesN b) { return LanesN(_mm256_div_pd(a.v, b.v)); }
+	friend LanesN operator-(LanesN a) { return LanesN(_mm256_sub_pd(_mm256_setzero_pd(), a.v)); }
+};
+#elif defined(ENSEMBLE_SSE2)
+struct LanesN
+{
+	enum { Width = 2 };
+	__m128d v;
+
+	LanesN() {}
+	LanesN(__m128d x) : v(x) {}
+	LanesN(double s) : v(_mm_set1_pd(s)) {}
+	static LanesN load(const double *p) { return LanesN(_mm_loadu_pd(p)); }
+	void store(double *p) const { _mm_storeu_pd(p, v); }
+	friend LanesN operator+(LanesN a, LanesN b) { return LanesN(_mm_add_pd(a.v, b.v)); }
+	friend LanesN operator-(LanesN a, LanesN b) { return LanesN(_mm_sub_pd(a.v, b.v)); }
+	friend LanesN operator*(LanesN a, LanesN b) { return LanesN(_mm_mul_pd(a.v, b.v)); }
+	friend LanesN operator/(LanesN a, LanesN b) { return LanesN(_mm_div_pd(a.v, b.v)); }
+	friend LanesN operator-(LanesN a) { return LanesN(_mm_sub_pd(_mm_setzero_pd(), a.v)); }
+};
+#else
+typedef Lanes1 LanesN;
+#endif
+
+// Same update rules as AdvanceTimeStep1, for V::Width springs at once
+template<class V, int method>
+static inline void StepLanes(const double *k, const double *m, const double *d, const double *L,
+	double dt, double p1, double *p2_, double *v2_)
+{
+	V p2 = V::load(p2_), v2 = V::load(v2_);
+	Spring1Method<method>::Step(V::load(k), V::load(m), V::load(d), V::load(L), V(dt), V(p1), p2, v2);
+	p2.store(p2_);
+	v2.store(v2_);
+}
+
+template<int method>
+struct EnsembleRun
+{
+	static void Run(const double *k, const double *m, const double *d, const double *L,
+		double dt, double p1, double *p2, double *v2, int n)
+	{
+		int i = 0;
+		for (; i + LanesN::Width <= n; i += LanesN::Width)
+			StepLanes<LanesN, method>(k + i, m + i, d + i, L + i, dt, p1, p2 + i, v2 + i);
+		for (; i < n; i++)
+			StepLanes<Lanes1, method>(k + i, m + i, d + i, L + i, dt, p1, p2 + i, v2 + i);
+	}
+};
+
+// exp/sin/cos have no vector instructions, evaluate lane by lane
+template<>
+struct EnsembleRun<Scene::ANALYTIC>
+{
+	static void Run(const double *k, const double *m, const double *d, const double *L,
+		double dt, double p1, double *p2, double *v2, int n)
+	{
+		for (int i = 0; i < n; i++)
+			Spring1Method<Scene::ANALYTIC>::Step(k[i], m[i], d[i], L[i], dt, p1, p2[i], v2[i]);
+	}
+};
+
+void AdvanceTimeStep1Batch(const double *k, const double *m, const double *d, const double *L,
+	double dt, int method, double p1, double *p2, double *v2, int n)
+{
+	// Select the kernel once per call, not once per spring
+	SelectKernel<EnsembleRun>(method)(k, m, d, L, dt, p1, p2, v2, n);
+}
+
+int EnsembleLaneWidth()
+{
+	return LanesN::Width;
+}
@@ -0,0 +1,21 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+// Advances n independent hanging mass points (Exercise 1) by one step of dt,
+// several springs per instruction. Every spring i has its own k[i], m[i],
+// d[i], L[i] and state p2[i], v2[i]; all hang from the same fixed point p1.
+//
+// Unlike AdvanceTimeStep1, ANALYTIC treats dt as a step as well: the exact
+// solution is propagated from the current state over dt.
+void AdvanceTimeStep1Batch(const double *k, const double *m, const double *d, const double *L,
+	double dt, int method, double p1, double *p2, double *v2, int n);
+
+// Number of springs advanced per instruction by AdvanceTimeStep1Batch. It is
+// fixed at compile time, there is no runtime dispatch: 2 with SSE2, the
+// default on x86-64, 4 with AVX and 8 with AVX-512, which need
+// USE_NATIVE_ARCH or the matching compiler flags.
+int EnsembleLaneWidth();
@@ -0,0 +1,49 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include "ParticleSystem.h"
+#include "AnalyticSolution.h"
+#include "TrajectoryWriter.h"
+
+// Gravitational acceleration (9.81 m/s^2)
+const double gravity = 9.81;
+
+// Penalty force keeping the particles above the ground
+const double groundHeight = -1.0;
+const double groundStiffness = 100.0;
+
+// Per-simulation state of the hanging mass point. Every concurrent
+// integration needs its own instance.
+struct Spring1State
+{
+	double x0, v0;	// initial conditions, used by the analytic solution
+	double t;		// elapsed simulated time
+	TrajectoryWriter *output;	// optional, receives (p2, v2) after each step
+	AnalyticSolution analytic;	// cached coefficients of the analytic solution
+	// Adaptive method: tolerances, proposed next step (0 = pick one) and
+	// step statistics
+	double rtol, atol;
+	double h;
+	long accepted, rejected;
+
+	Spring1State(double _x0 = 0.0, double _v0 = 0.0) : x0(_x0), v0(_v0), t(0.0), output(nullptr),
+		rtol(1e-6), atol(1e-9), h(0.0), accepted(0), rejected(0) {}
+};
+
+// Simulation loop of the hanging mass point compiled for one method, see
+// Spring1Run in Integrators.h: nSteps steps of dt starting at state.t
+typedef void (*Spring1Kernel)(double k, double m, double d, double L, double dt, double p1, double &p2, double &v2, int nSteps, Spring1State &state);
+
+// Exercise 1: hanging mass point, see Exercise.cpp
+void AdvanceTimeStep1(double k, double m, double d, double L, double dt, int method, double p1, double v1, double& p2, double& v2, Spring1State& state);
+
+// Closed-form solution of the hanging mass point started at (x0, v0),
+// evaluated after time t
+void AnalyticSpring1(double k, double m, double d, double L, double p1, double x0, double v0, double t, double& p2, double& v2);
+
+// Exercise 3: falling spring network, see Exercise.cpp
+void AdvanceTimeStep3(double d, double dt, ParticleSystem& ps);
@@ -0,0 +1,160 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "ExplicitSolver.h"
+#include "Scene.h"
+#include "Exercise.h"
+#include "Profiler.h"
+#include <stdexcept>
+
+bool ExplicitSolver::Supports(int method)
+{
+	return method == Scene::EULER || method == Scene::LEAP_FROG || method == Scene::MIDPOINT
+		|| method == Scene::RK4 || method == Scene::VELOCITY_VERLET;
+}
+
+void ExplicitSolver::Evaluate(ParticleSystem &ps, double d, int s)
+{
+	{
+		PROFILE_SCOPE("Forces");
+		ps.ClearForces();
+		ps.AddSpringForces();
+		ps.AddDampingForces(d);
+		ps.AddGroundPenalty(groundHeight, groundStiffness);
+	}
+	ps.AddContactForces();
+
+	const int n = ps.ParticleCount();
+	for (int i = 0; i < n; i++)
+	{
+		const double w = ps.invMass[i];
+		ax[s][i] = w * ps.fx[i];
+		// gravity is an acceleration, fixed particles stay at rest
+		ay[s][i] = (w == 0.0) ? 0.0 : w * ps.fy[i] - gravity;
+	}
+}
+
+void ExplicitSolver::SetState(ParticleSystem &ps, double h, int s)
+{
+	const int n = ps.ParticleCount();
+	for (int i = 0; i < n; i++)
+	{
+		ps.x[i] = x0[i] + h * vx[s][i];
+		ps.y[i] = y0[i] + h * vy[s][i];
+		ps.vx[i] = vx0[i] + h * ax[s][i];
+		ps.vy[i] = vy0[i] + h * ay[s][i];
+	}
+}
+
+void ExplicitSolver::SaveStart(const ParticleSystem &ps)
+{
+	const int n = ps.ParticleCount();
+	x0 = ps.x; y0 = ps.y;
+	vx0 = ps.vx; vy0 = ps.vy;
+	for (int s = 0; s < 4; s++)
+	{
+		vx[s].resize(n); vy[s].resize(n);
+		ax[s].resize(n); ay[s].resize(n);
+	}
+}
+
+void ExplicitSolver::Step(ParticleSystem &ps, int method, double d, double dt)
+{
+	const int n = ps.ParticleCount();
+	SaveStart(ps);
+	Evaluate(ps, d, 0);
+	vx[0] = vx0; vy[0] = vy0;
+
+	PROFILE_SCOPE("Integrate");
+	switch (method)
+	{
+	case Scene::EULER:
+		SetState(ps, dt, 0);
+		break;
+
+	case Scene::LEAP_FROG:
+		// drift with the start acceleration, then average it with the one at
+		// the new positions and the old velocities
+		for (int i = 0; i < n; i++)
+		{
+			ps.x[i] = x0[i] + (vx0[i] * dt + 0.5 * ax[0][i] * dt * dt);
+			ps.y[i] = y0[i] + (vy0[i] * dt + 0.5 * ay[0][i] * dt * dt);
+		}
+		Evaluate(ps, d, 1);
+		for (int i = 0; i < n; i++)
+		{
+			ps.vx[i] = vx0[i] + 0.5 * (ax[0][i] + ax[1][i]) * dt;
+			ps.vy[i] = vy0[i] + 0.5 * (ay[0][i] + ay[1][i]) * dt;
+		}
+		break;
+
+	case Scene::MIDPOINT:
+		// velocity of the half step, then positions half a step along it
+		for (int i = 0; i < n; i++)
+		{
+			vx[1][i] = vx0[i] + dt * ax[0][i] / 2.0;
+			vy[1][i] = vy0[i] + dt * ay[0][i] / 2.0;
+			ps.x[i] = x0[i] + dt * vx[1][i] / 2.0;
+			ps.y[i] = y0[i] + dt * vy[1][i] / 2.0;
+			ps.vx[i] = vx[1][i];
+			ps.vy[i] = vy[1][i];
+		}
+		Evaluate(ps, d, 1);
+		for (int i = 0; i < n; i++)
+		{
+			ps.x[i] = x0[i] + dt * vx[1][i];
+			ps.y[i] = y0[i] + dt * vy[1][i];
+			ps.vx[i] = vx0[i] + dt * ax[1][i];
+			ps.vy[i] = vy0[i] + dt * ay[1][i];
+		}
+		break;
+
+	case Scene::RK4:
+	{
+		const double half = 0.5 * dt;
+		const double h[3] = { half, half, dt };
+		for (int s = 1; s < 4; s++)
+		{
+			SetState(ps, h[s - 1], s - 1);
+			vx[s] = ps.vx; vy[s] = ps.vy;
+			Evaluate(ps, d, s);
+		}
+		for (int i = 0; i < n; i++)
+		{
+			ps.x[i] = x0[i] + dt / 6.0 * (vx[0][i] + 2.0 * (vx[1][i] + vx[2][i]) + vx[3][i]);
+			ps.y[i] = y0[i] + dt / 6.0 * (vy[0][i] + 2.0 * (vy[1][i] + vy[2][i]) + vy[3][i]);
+			ps.vx[i] = vx0[i] + dt / 6.0 * (ax[0][i] + 2.0 * (ax[1][i] + ax[2][i]) + ax[3][i]);
+			ps.vy[i] = vy0[i] + dt / 6.0 * (ay[0][i] + 2.0 * (ay[1][i] + ay[2][i]) + ay[3][i]);
+		}
+		break;
+	}
+
+	case Scene::VELOCITY_VERLET:
+	{
+		// kick, drift, then the second kick with the conservative forces at
+		// the new positions and the damping at the new velocity, which is
+		// linear and solved in closed form
+		const double half = 0.5 * dt;
+		for (int i = 0; i < n; i++)
+		{
+			ps.vx[i] = vx0[i] + half * ax[0][i];
+			ps.vy[i] = vy0[i] + half * ay[0][i];
+			ps.x[i] = x0[i] + dt * ps.vx[i];
+			ps.y[i] = y0[i] + dt * ps.vy[i];
+		}
+		Evaluate(ps, 0.0, 1);
+		for (int i = 0; i < n; i++)
+		{
+			const double scale = 1.0 / (1.0 + half * d * ps.invMass[i]);
+			ps.vx[i] = (ps.vx[i] + half * ax[1][i]) * scale;
+			ps.vy[i] = (ps.vy[i] + half * ay[1][i]) * scale;
+		}
+		break;
+	}
+
+	default:
+		throw std::invalid_argument("Method chosen has no explicit network integrator");
+	}
+}
@@ -0,0 +1,36 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <vector>
+#include "ParticleSystem.h"
+
+// The explicit methods of the hanging mass point (Spring1Method in
+// Integrators.h) for spring networks, so a method name runs the same update
+// rule on every testcase. The forces are those of AdvanceTimeStep3: springs,
+// damping, the ground penalty and the particle contacts. backwards_euler is
+// AdvanceTimeStep3 itself.
+class ExplicitSolver
+{
+public:
+	// EULER, LEAP_FROG, MIDPOINT, RK4 or VELOCITY_VERLET
+	static bool Supports(int method);
+
+	void Step(ParticleSystem &ps, int method, double d, double dt);
+
+private:
+	// Accelerations of stage s at the positions and velocities in ps
+	void Evaluate(ParticleSystem &ps, double d, int s);
+	// Writes the start state plus h times the velocities and accelerations
+	// of stage s into ps
+	void SetState(ParticleSystem &ps, double h, int s);
+	void SaveStart(const ParticleSystem &ps);
+
+	// state at the start of the step
+	std::vector<double> x0, y0, vx0, vy0;
+	// stage velocities and accelerations
+	std::vector<double> vx[4], vy[4], ax[4], ay[4];
+};
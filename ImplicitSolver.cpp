@@ -0,0 +1,223 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "ImplicitSolver.h"
+#include "Exercise.h"
+#include "Profiler.h"
+#include <math.h>
+#include <algorithm>
+
+void BlockSparseMatrix::BuildPattern(int nParticles, const std::vector<int> &springA, const std::vector<int> &springB,
+	std::vector<int> &blockAB, std::vector<int> &blockBA)
+{
+	const int nSprings = (int)springA.size();
+
+	// neighbours of every particle, sorted and without duplicates
+	std::vector<std::vector<int> > neighbours(nParticles);
+	for (int s = 0; s < nSprings; s++)
+	{
+		neighbours[springA[s]].push_back(springB[s]);
+		neighbours[springB[s]].push_back(springA[s]);
+	}
+
+	rowStart.assign(nParticles + 1, 0);
+	column.clear();
+	for (int i = 0; i < nParticles; i++)
+	{
+		std::vector<int> &n = neighbours[i];
+		std::sort(n.begin(), n.end());
+		n.erase(std::unique(n.begin(), n.end()), n.end());
+
+		rowStart[i] = (int)column.size();
+		column.push_back(i);
+		for (size_t j = 0; j < n.size(); j++)
+			if (n[j] != i)
+				column.push_back(n[j]);
+	}
+	rowStart[nParticles] = (int)column.size();
+	blocks.resize(column.size());
+
+	// position of the off-diagonal blocks of every spring
+	blockAB.resize(nSprings);
+	blockBA.resize(nSprings);
+	for (int s = 0; s < nSprings; s++)
+	{
+		const int a = springA[s], b = springB[s];
+		blockAB[s] = (int)(std::lower_bound(column.begin() + rowStart[a] + 1, column.begin() + rowStart[a + 1], b) - column.begin());
+		blockBA[s] = (int)(std::lower_bound(column.begin() + rowStart[b] + 1, column.begin() + rowStart[b + 1], a) - column.begin());
+	}
+}
+
+void BlockSparseMatrix::SetZero()
+{
+	for (size_t i = 0; i < blocks.size(); i++)
+		blocks[i].setZero();
+}
+
+void BlockSparseMatrix::Multiply(const std::vector<Vec2> &x, std::vector<Vec2> &y) const
+{
+	const int n = Rows();
+	for (int i = 0; i < n; i++)
+	{
+		Vec2 sum(0.0, 0.0);
+		for (int j = rowStart[i]; j < rowStart[i + 1]; j++)
+			sum += blocks[j] * x[column[j]];
+		y[i] = sum;
+	}
+}
+
+void ImplicitEulerSolver::Step(ParticleSystem &ps, double d, double dt)
+{
+	// the pattern only changes with the topology; a network of the same
+	// size can still connect other particles
+	if (ps.Version() != version)
+	{
+		version = ps.Version();
+		nParticles = ps.ParticleCount();
+		nSprings = ps.SpringCount();
+		A.BuildPattern(nParticles, ps.springA, ps.springB, blockAB, blockBA);
+		b.resize(nParticles); dv.resize(nParticles);
+		r.resize(nParticles); z.resize(nParticles);
+		p.resize(nParticles); Ap.resize(nParticles);
+		preconditioner.resize(nParticles);
+		filter.resize(nParticles);
+	}
+
+	{
+		PROFILE_SCOPE("Assemble");
+		Assemble(ps, d, dt);
+	}
+	{
+		PROFILE_SCOPE("Solve");
+		Solve();
+	}
+
+	PROFILE_SCOPE("Integrate");
+	for (int i = 0; i < nParticles; i++)
+	{
+		if (ps.IsFixed(i))
+			continue;
+		ps.vx[i] += dv[i].x();
+		ps.vy[i] += dv[i].y();
+		ps.x[i] += dt * ps.vx[i];
+		ps.y[i] += dt * ps.vy[i];
+	}
+}
+
+void ImplicitEulerSolver::Assemble(ParticleSystem &ps, double d, double dt)
+{
+	const double dt2 = dt * dt;
+	Mat2 I;
+	I.setIdentity();
+
+	A.SetZero();
+	for (int i = 0; i < nParticles; i++)
+	{
+		filter[i] = ps.IsFixed(i) ? 0.0 : 1.0;
+		const double m = ps.IsFixed(i) ? 1.0 : 1.0 / ps.invMass[i];
+		A.blocks[A.Diagonal(i)] = (m + dt * d) * I;
+		// f = m g - d v, plus dt K v added below
+		b[i] = Vec2(-d * ps.vx[i], -d * ps.vy[i] - m * gravity);
+	}
+
+	for (int s = 0; s < nSprings; s++)
+	{
+		const int ia = ps.springA[s], ib = ps.springB[s];
+		Vec2 x(ps.x[ib] - ps.x[ia], ps.y[ib] - ps.y[ia]);
+		const double l = x.length();
+		const Vec2 n = x / l;
+		const double k = ps.springK[s];
+
+		// spring force on a, and its Jacobian -Ks with respect to x_a
+		const Vec2 f = k * (l - ps.restLength[s]) * n;
+		Mat2 nn(n.x() * n.x(), n.x() * n.y(), n.y() * n.x(), n.y() * n.y());
+		// the transverse term is dropped under compression to keep A positive definite
+		const double transverse = std::max(0.0, 1.0 - ps.restLength[s] / l);
+		const Mat2 Ks = k * (nn + transverse * (I - nn));
+
+		const Vec2 dvel(ps.vx[ib] - ps.vx[ia], ps.vy[ib] - ps.vy[ia]);
+		const Vec2 Kv = dt * (Ks * dvel);
+		b[ia] += f + Kv;
+		b[ib] -= f + Kv;
+
+		const Mat2 block = dt2 * Ks;
+		A.blocks[A.Diagonal(ia)] += block;
+		A.blocks[A.Diagonal(ib)] += block;
+		A.blocks[blockAB[s]] -= block;
+		A.blocks[blockBA[s]] -= block;
+	}
+
+	// ground penalty, linear in the penetration depth
+	for (int i = 0; i < nParticles; i++)
+	{
+		const double penetration = ps.y[i] - groundHeight;
+		if (penetration > 0)
+			continue;
+		b[i].y() += -groundStiffness * (penetration + dt * ps.vy[i]);
+		A.blocks[A.Diagonal(i)](1, 1) += dt2 * groundStiffness;
+	}
+
+	// contacts are not linearized
+	if (ps.radius > 0.0)
+	{
+		ps.ClearForces();
+		ps.AddContactForces();
+		for (int i = 0; i < nParticles; i++)
+			b[i] += Vec2(ps.fx[i], ps.fy[i]);
+	}
+
+	for (int i = 0; i < nParticles; i++)
+	{
+		b[i] *= dt * filter[i];
+		preconditioner[i] = A.blocks[A.Diagonal(i)].inverse();
+	}
+}
+
+void ImplicitEulerSolver::Solve()
+{
+	// Preconditioned CG on the free particles, starting from dv = 0
+	double bnorm2 = 0.0;
+	for (int i = 0; i < nParticles; i++)
+	{
+		dv[i] = Vec2(0.0, 0.0);
+		r[i] = b[i];
+		z[i] = filter[i] * (preconditioner[i] * r[i]);
+		p[i] = z[i];
+		bnorm2 += b[i] | b[i];
+	}
+	double rz = 0.0;
+	for (int i = 0; i < nParticles; i++)
+		rz += r[i] | z[i];
+
+	const double threshold = tolerance * tolerance * bnorm2;
+	double rnorm2 = bnorm2;
+	for (iterations = 0; iterations < maxIterations && rnorm2 > threshold; iterations++)
+	{
+		A.Multiply(p, Ap);
+		double pAp = 0.0;
+		for (int i = 0; i < nParticles; i++)
+		{
+			Ap[i] *= filter[i];
+			pAp += p[i] | Ap[i];
+		}
+		const double alpha = rz / pAp;
+
+		double rzNew = 0.0;
+		rnorm2 = 0.0;
+		for (int i = 0; i < nParticles; i++)
+		{
+			dv[i] += alpha * p[i];
+			r[i] -= alpha * Ap[i];
+			z[i] = filter[i] * (preconditioner[i] * r[i]);
+			rzNew += r[i] | z[i];
+			rnorm2 += r[i] | r[i];
+		}
+
+		const double beta = rzNew / rz;
+		rz = rzNew;
+		for (int i = 0; i < nParticles; i++)
+			p[i] = z[i] + beta * p[i];
+	}
+}
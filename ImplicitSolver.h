@@ -0,0 +1,69 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <vector>
+#include "ParticleSystem.h"
+#include "Utilities/Vector2T.h"
+#include "Utilities/Matrix2x2T.h"
+
+typedef Matrix2x2T<double> Mat2;
+
+// Symmetric sparse matrix of 2x2 blocks in compressed row storage, one block
+// row per particle with the diagonal block stored first
+class BlockSparseMatrix
+{
+public:
+	std::vector<int> rowStart;	// size rows + 1
+	std::vector<int> column;	// block column of each stored block
+	std::vector<Mat2> blocks;
+
+	int Rows() const { return (int)rowStart.size() - 1; }
+	int Diagonal(int row) const { return rowStart[row]; }
+
+	// Build the pattern of the spring graph, returns for every spring the
+	// indices of its (a, b) and (b, a) blocks
+	void BuildPattern(int nParticles, const std::vector<int> &springA, const std::vector<int> &springB,
+		std::vector<int> &blockAB, std::vector<int> &blockBA);
+	void SetZero();
+	// y = A x
+	void Multiply(const std::vector<Vec2> &x, std::vector<Vec2> &y) const;
+};
+
+// Backward Euler for spring networks: linearizes the spring and ground
+// forces around the current state, assembles
+//   (M + dt D - dt^2 K) dv = dt (f + dt K v)
+// and solves it with conjugate gradients, preconditioned with the inverses
+// of the diagonal blocks. Fixed particles are excluded from the solve.
+// Particle-particle contacts change every step and enter explicitly.
+class ImplicitEulerSolver
+{
+public:
+	// CG stops at |r| <= tolerance * |b| or after maxIterations
+	double tolerance;
+	int maxIterations;
+	// Iterations of the last solve
+	int iterations;
+
+	ImplicitEulerSolver(void) : tolerance(1e-8), maxIterations(500), iterations(0), nParticles(0), nSprings(0), version(0) {}
+
+	void Step(ParticleSystem &ps, double d, double dt);
+
+private:
+	void Assemble(ParticleSystem &ps, double d, double dt);
+	void Solve();
+
+	BlockSparseMatrix A;
+	std::vector<int> blockAB, blockBA;
+	int nParticles, nSprings;
+	// ParticleSystem::Version the pattern was built for
+	uint64_t version;
+
+	// right-hand side, solution and CG temporaries
+	std::vector<Vec2> b, dv, r, z, p, Ap;
+	std::vector<Mat2> preconditioner;
+	std::vector<double> filter;	// 0 for fixed particles, 1 otherwise
+};
@@ -0,0 +1,335 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <math.h>
+#include "Scene.h"
+#include "Exercise.h"
+#include "AdaptiveSolver.h"
+
+// Update rules of the hanging mass point (Exercise 1), one policy per
+// Scene::Method. T is double or one of the SIMD lane types of Ensemble.cpp,
+// so the scalar and the batched integrators share the same code.
+template<int method> struct Spring1Method;
+
+// Force on the hanging mass point
+template<class T>
+inline T Spring1Force(T k, T m, T d, T L, T p1, T p2, T v2)
+{
+	T Fg		= -m * T(gravity);
+	T Fspring	=  k * ((p1 - p2) - L);
+	T Fdamp		= -d * v2;
+	return Fg + Fspring + Fdamp;
+}
+
+template<> struct Spring1Method<Scene::EULER>
+{
+	template<class T>
+	static inline void Step(T k, T m, T d, T L, T dt, T p1, T &p2, T &v2)
+	{
+		T F = Spring1Force(k, m, d, L, p1, p2, v2);
+		// calculate new location
+		p2 = p2 + dt * v2;
+		// calculate new velocity
+		v2 = v2 + dt * F / m;
+	}
+};
+
+template<> struct Spring1Method<Scene::LEAP_FROG>
+{
+	template<class T>
+	static inline void Step(T k, T m, T d, T L, T dt, T p1, T &p2, T &v2)
+	{
+		T F = Spring1Force(k, m, d, L, p1, p2, v2);
+		// calculate new location
+		p2 = p2 + (v2 * dt + T(0.5) * F / m * dt * dt);
+		// forces at next point
+		T F_next = Spring1Force(k, m, d, L, p1, p2, v2);
+		// calculate new velocity
+		v2 = v2 + T(0.5) * ((F + F_next) / m) * dt;
+	}
+};
+
+template<> struct Spring1Method<Scene::MIDPOINT>
+{
+	template<class T>
+	static inline void Step(T k, T m, T d, T L, T dt, T p1, T &p2, T &v2)
+	{
+		T F = Spring1Force(k, m, d, L, p1, p2, v2);
+		// velocity and location of next half point
+		T v2_half = v2 + dt * F / (T(2.0) * m);
+		T p2_half = p2 + dt * v2_half / T(2.0);
+		// forces at half point
+		T F_half = Spring1Force(k, m, d, L, p1, p2_half, v2_half);
+		// location and velocity of next point
+		p2 = p2 + dt * v2_half;
+		v2 = v2 + dt * F_half / m;
+	}
+};
+
+template<> struct Spring1Method<Scene::BACK_EULER>
+{
+	template<class T>
+	static inline void Step(T k, T m, T d, T L, T dt, T p1, T &p2, T &v2)
+	{
+		T F = Spring1Force(k, m, d, L, p1, p2, v2);
+		// calculate new velocity
+		v2 = v2 + dt * F / m;
+		// calculate location with new velocity
+		p2 = p2 + dt * v2;
+	}
+};
+
+template<> struct Spring1Method<Scene::ANALYTIC>
+{
+	// Exact propagation over dt from the current state (scalar only)
+	static inline void Step(double k, double m, double d, double L, double dt, double p1, double &p2, double &v2)
+	{
+		AnalyticSolution(k, m, d, L, p1, p2, v2).Evaluate(dt, p2, v2);
+	}
+};
+
+// Backward Euler: the force is linear in p2 and v2, so the implicit update
+// v2' = v2 + dt F(p2 + dt v2', v2') / m is solved in closed form
+template<> struct Spring1Method<Scene::IMPLICIT_EULER>
+{
+	template<class T>
+	static inline void Step(T k, T m, T d, T L, T dt, T p1, T &p2, T &v2)
+	{
+		T Fg = -m * T(gravity);
+		T Fspring = k * ((p1 - p2) - L);
+		v2 = (v2 + dt * (Fg + Fspring) / m) / (T(1.0) + dt * d / m + dt * dt * k / m);
+		p2 = p2 + dt * v2;
+	}
+};
+
+// Classic fourth-order Runge-Kutta
+template<> struct Spring1Method<Scene::RK4>
+{
+	template<class T>
+	static inline void Step(T k, T m, T d, T L, T dt, T p1, T &p2, T &v2)
+	{
+		const T half = T(0.5) * dt;
+		T a1 = Spring1Force(k, m, d, L, p1, p2, v2) / m;
+		T pb = p2 + half * v2, vb = v2 + half * a1;
+		T a2 = Spring1Force(k, m, d, L, p1, pb, vb) / m;
+		T pc = p2 + half * vb, vc = v2 + half * a2;
+		T a3 = Spring1Force(k, m, d, L, p1, pc, vc) / m;
+		T pd = p2 + dt * vc, vd = v2 + dt * a3;
+		T a4 = Spring1Force(k, m, d, L, p1, pd, vd) / m;
+		p2 = p2 + dt / T(6.0) * (v2 + T(2.0) * (vb + vc) + vd);
+		v2 = v2 + dt / T(6.0) * (a1 + T(2.0) * (a2 + a3) + a4);
+	}
+};
+
+// Velocity Verlet (Stoermer-Verlet): kick, drift, kick. Unlike LEAP_FROG,
+// which damps the second kick with the old velocity, the damping of the
+// second kick is taken at the new velocity. It is linear, so the implicit
+// kick is solved in closed form and the scheme stays second order.
+template<> struct Spring1Method<Scene::VELOCITY_VERLET>
+{
+	template<class T>
+	static inline void Step(T k, T m, T d, T L, T dt, T p1, T &p2, T &v2)
+	{
+		const T half = T(0.5) * dt;
+		T vHalf = v2 + half * Spring1Force(k, m, d, L, p1, p2, v2) / m;
+		p2 = p2 + dt * vHalf;
+		// conservative force at the new position, damping at the new velocity
+		T F = Spring1Force(k, m, T(0.0), L, p1, p2, vHalf);
+		v2 = (vHalf + half * F / m) / (T(1.0) + half * d / m);
+	}
+};
+
+// XPBD with the spring as a distance constraint of compliance 1/k to the
+// fixed point: predict with gravity and damping, project, derive the velocity.
+// A single constraint with one fixed end is solved exactly by one projection,
+// so the iteration count of the network solver does not matter here.
+template<> struct Spring1Method<Scene::XPBD>
+{
+	template<class T>
+	static inline void Step(T k, T m, T d, T L, T dt, T p1, T &p2, T &v2)
+	{
+		T v = v2 + dt * (-m * T(gravity) - d * v2) / m;
+		T p = p2 + dt * v;
+		// C = (p1 - p) - L with gradient -1 with respect to p
+		T w = T(1.0) / m;
+		T alpha = T(1.0) / (k * dt * dt);
+		p = p + w * ((p1 - p) - L) / (w + alpha);
+		v2 = (p - p2) / dt;
+		p2 = p;
+	}
+};
+
+// Projective dynamics: the local step projects the spring onto its rest
+// length below the fixed point, the global step is the scalar implicit solve
+// of inertia against the projected spring. The projection does not change
+// while the mass point stays below p1, so one local/global iteration
+// converges.
+template<> struct Spring1Method<Scene::PROJECTIVE_DYNAMICS>
+{
+	template<class T>
+	static inline void Step(T k, T m, T d, T L, T dt, T p1, T &p2, T &v2)
+	{
+		T s = p2 + dt * (v2 + dt * (-m * T(gravity) - d * v2) / m);
+		T inertia = m / (dt * dt);
+		T p = (inertia * s + k * (p1 - L)) / (inertia + k);
+		v2 = (p - p2) / dt;
+		p2 = p;
+	}
+};
+
+// Third-order Bogacki-Shampine step of fixed size. Ensembles and the
+// stability measurement step all lanes with the same dt and use this;
+// Spring1Run adds the error control.
+template<> struct Spring1Method<Scene::ADAPTIVE_RK23>
+{
+	template<class T>
+	static inline void Step(T k, T m, T d, T L, T dt, T p1, T &p2, T &v2)
+	{
+		using namespace BogackiShampine;
+		T a1 = Spring1Force(k, m, d, L, p1, p2, v2) / m;
+		T p = p2 + T(a21) * dt * v2, v = v2 + T(a21) * dt * a1;
+		T a2 = Spring1Force(k, m, d, L, p1, p, v) / m;
+		T w2 = v;
+		p = p2 + T(a32) * dt * w2; v = v2 + T(a32) * dt * a2;
+		T a3 = Spring1Force(k, m, d, L, p1, p, v) / m;
+		p2 = p2 + dt * (T(b1) * v2 + T(b2) * w2 + T(b3) * v);
+		v2 = v2 + dt * (T(b1) * a1 + T(b2) * a2 + T(b3) * a3);
+	}
+};
+
+// Simulation loop of the hanging mass point for a fixed method: nSteps steps
+// of dt, advancing state.t and recording every step in state.output.
+template<int method>
+struct Spring1Run
+{
+	static void Run(double k, double m, double d, double L, double dt, double p1, double &p2, double &v2, int nSteps, Spring1State &state)
+	{
+		for (int i = 0; i < nSteps; i++)
+		{
+			Spring1Method<method>::Step(k, m, d, L, dt, p1, p2, v2);
+			state.t += dt;
+			if (state.output)
+			{
+				const double values[2] = { p2, v2 };
+				state.output->Write(state.t, values);
+			}
+		}
+	}
+};
+
+// The analytic solution is evaluated at the absolute time from the initial
+// state instead of being propagated, so no error accumulates
+template<>
+struct Spring1Run<Scene::ANALYTIC>
+{
+	static void Run(double k, double m, double d, double L, double dt, double p1, double &p2, double &v2, int nSteps, Spring1State &state)
+	{
+		if (!state.analytic.Matches(k, m, d, L, p1, state.x0, state.v0))
+			state.analytic = AnalyticSolution(k, m, d, L, p1, state.x0, state.v0);
+		for (int i = 0; i < nSteps; i++)
+		{
+			state.t += dt;
+			state.analytic.Evaluate(state.t, p2, v2);
+			if (state.output)
+			{
+				const double values[2] = { p2, v2 };
+				state.output->Write(state.t, values);
+			}
+		}
+	}
+};
+
+// Error-controlled Bogacki-Shampine: the nSteps * dt interval is covered by
+// as many steps as state.rtol and state.atol require, and every accepted step
+// is recorded at its own time. The step size carries over in state.h, so
+// quiet phases take steps as long as the whole interval.
+template<>
+struct Spring1Run<Scene::ADAPTIVE_RK23>
+{
+	static void Run(double k, double m, double d, double L, double dt, double p1, double &p2, double &v2, int nSteps, Spring1State &state)
+	{
+		using namespace BogackiShampine;
+		const double interval = nSteps * dt;
+		if (interval <= 0.0)
+			return;
+		if (state.h <= 0.0)
+			state.h = interval;
+
+		const double t0 = state.t;
+		double t = 0.0;
+		// first stage, the last stage of an accepted step is the next first one
+		double a1 = Spring1Force(k, m, d, L, p1, p2, v2) / m;
+		while (t < interval)
+		{
+			const bool last = (t + state.h >= interval);
+			const double h = last ? interval - t : state.h;
+
+			double p = p2 + a21 * h * v2, v = v2 + a21 * h * a1;
+			const double w2 = v, a2 = Spring1Force(k, m, d, L, p1, p, v) / m;
+			p = p2 + a32 * h * w2; v = v2 + a32 * h * a2;
+			const double w3 = v, a3 = Spring1Force(k, m, d, L, p1, p, v) / m;
+			const double pNew = p2 + h * (b1 * v2 + b2 * w2 + b3 * w3);
+			const double vNew = v2 + h * (b1 * a1 + b2 * a2 + b3 * a3);
+			const double a4 = Spring1Force(k, m, d, L, p1, pNew, vNew) / m;
+
+			// weighted RMS of the difference to the second-order solution
+			const double errP = h * (e1 * v2 + e2 * w2 + e3 * w3 + e4 * vNew);
+			const double errV = h * (e1 * a1 + e2 * a2 + e3 * a3 + e4 * a4);
+			const double scaleP = state.atol + state.rtol * std::max(fabs(p2), fabs(pNew));
+			const double scaleV = state.atol + state.rtol * std::max(fabs(v2), fabs(vNew));
+			const double norm = sqrt(0.5 * ((errP / scaleP) * (errP / scaleP) + (errV / scaleV) * (errV / scaleV)));
+
+			const double next = NextStep(h, norm);
+			if (norm <= 1.0 || h <= minStep)
+			{
+				state.accepted++;
+				t = last ? interval : t + h;
+				p2 = pNew; v2 = vNew; a1 = a4;
+				state.t = t0 + t;
+				// a step shortened to hit the interval end does not shrink
+				// the proposal for the next interval
+				if (!last || next > state.h)
+					state.h = next;
+				if (state.output)
+				{
+					const double values[2] = { p2, v2 };
+					state.output->Write(state.t, values);
+				}
+			}
+			else
+			{
+				state.rejected++;
+				state.h = std::max(next, minStep);
+			}
+		}
+	}
+};
+
+// Runtime dispatch table: Kernel<method>::Run for a method known only at
+// runtime. Select once, outside of the simulation loop.
+template<template<int> class Kernel>
+inline decltype(&Kernel<Scene::EULER>::Run) SelectKernel(int method)
+{
+	switch (method)
+	{
+	case Scene::EULER:		return &Kernel<Scene::EULER>::Run;
+	case Scene::LEAP_FROG:	return &Kernel<Scene::LEAP_FROG>::Run;
+	case Scene::MIDPOINT:	return &Kernel<Scene::MIDPOINT>::Run;
+	case Scene::BACK_EULER:	return &Kernel<Scene::BACK_EULER>::Run;
+	case Scene::ANALYTIC:	return &Kernel<Scene::ANALYTIC>::Run;
+	case Scene::IMPLICIT_EULER:	return &Kernel<Scene::IMPLICIT_EULER>::Run;
+	case Scene::ADAPTIVE_RK23:	return &Kernel<Scene::ADAPTIVE_RK23>::Run;
+	case Scene::RK4:		return &Kernel<Scene::RK4>::Run;
+	case Scene::VELOCITY_VERLET:	return &Kernel<Scene::VELOCITY_VERLET>::Run;
+	case Scene::XPBD:		return &Kernel<Scene::XPBD>::Run;
+	case Scene::PROJECTIVE_DYNAMICS:	return &Kernel<Scene::PROJECTIVE_DYNAMICS>::Run;
+	default:
+		throw std::invalid_argument("Method chosen is invalid");
+	}
+}
@@ -0,0 +1,31 @@
+"""Load a binary trajectory written with Exercise1 -out <file>.
+
+Usage: python read_trajectory.py file.traj
+Returns (header, t, values) from read_trajectory(); values has one row per
+record and one column per channel.
+"""
+import struct
+import sys
+
+import numpy as np
+
+
+def read_trajectory(filename):
+    with open(filename, "rb") as f:
+        raw = f.read()
+    if raw[:8] != b"MSPTRAJ1":
+        raise ValueError("not a trajectory file: %s" % filename)
+    header_size, value_size, channels, stride, method, testcase = struct.unpack_from("<IIIIii", raw, 8)
+    stiffness, mass, damping, step = struct.unpack_from("<dddd", raw, 32)
+    header = dict(channels=channels, stride=stride, method=method, testcase=testcase,
+                  stiffness=stiffness, mass=mass, damping=damping, step=step)
+    dtype = np.float64 if value_size == 8 else np.float32
+    data = np.frombuffer(raw, dtype=dtype, offset=header_size)
+    data = data[: len(data) - len(data) % (channels + 1)].reshape(-1, channels + 1)
+    return header, data[:, 0], data[:, 1:]
+
+
+if __name__ == "__main__":
+    header, t, values = read_trajectory(sys.argv[1])
+    print(header)
+    print("%d records, t = %g .. %g" % (len(t), t[0], t[-1]))
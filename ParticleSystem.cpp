@@ -0,0 +1,247 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "ParticleSystem.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <math.h>
+#include <atomic>
+
+uint64_t ParticleSystem::NextVersion()
+{
+	static std::atomic<uint64_t> counter(0);
+	return ++counter;
+}
+
+void ParticleSystem::Clear()
+{
+	x.clear(); y.clear();
+	vx.clear(); vy.clear();
+	fx.clear(); fy.clear();
+	invMass.clear();
+	springA.clear(); springB.clear();
+	restLength.clear();
+	springK.clear();
+	colorStart.clear();
+	springOrder.clear();
+	Modified();
+}
+
+void ParticleSystem::Reserve(int nParticles, int nSprings)
+{
+	x.reserve(nParticles); y.reserve(nParticles);
+	vx.reserve(nParticles); vy.reserve(nParticles);
+	fx.reserve(nParticles); fy.reserve(nParticles);
+	invMass.reserve(nParticles);
+	springA.reserve(nSprings); springB.reserve(nSprings);
+	restLength.reserve(nSprings);
+	springK.reserve(nSprings);
+}
+
+int ParticleSystem::AddParticle(double px, double py, double mass, bool fixed)
+{
+	x.push_back(px); y.push_back(py);
+	vx.push_back(0.0); vy.push_back(0.0);
+	fx.push_back(0.0); fy.push_back(0.0);
+	invMass.push_back(fixed ? 0.0 : 1.0 / mass);
+	Modified();
+	return ParticleCount() - 1;
+}
+
+int ParticleSystem::AddSpring(int a, int b, double k)
+{
+	double dx = x[b] - x[a];
+	double dy = y[b] - y[a];
+	return AddSpring(a, b, k, sqrt(dx * dx + dy * dy));
+}
+
+int ParticleSystem::AddSpring(int a, int b, double k, double L)
+{
+	springA.push_back(a);
+	springB.push_back(b);
+	restLength.push_back(L);
+	springK.push_back(k);
+	if (!springOrder.empty())
+		springOrder.push_back(SpringCount() - 1);
+	Modified();
+	return SpringCount() - 1;
+}
+
+void ParticleSystem::ColorSprings()
+{
+	const int n = ParticleCount();
+	const int m = SpringCount();
+
+	// springs incident to every particle
+	std::vector<int> first(n + 1, 0), incident(2 * m);
+	for (int s = 0; s < m; s++)
+	{
+		first[springA[s] + 1]++;
+		first[springB[s] + 1]++;
+	}
+	for (int i = 0; i < n; i++)
+		first[i + 1] += first[i];
+	std::vector<int> fill(first.begin(), first.end() - 1);
+	for (int s = 0; s < m; s++)
+	{
+		incident[fill[springA[s]]++] = s;
+		incident[fill[springB[s]]++] = s;
+	}
+
+	// smallest color not taken by an already colored neighbour spring
+	std::vector<int> color(m, -1);
+	std::vector<int> takenBy;
+	for (int s = 0; s < m; s++)
+	{
+		const int ends[2] = { springA[s], springB[s] };
+		for (int p : ends)
+			for (int i = first[p]; i < first[p + 1]; i++)
+				if (color[incident[i]] >= 0)
+					takenBy[color[incident[i]]] = s;
+		int c = 0;
+		while (c < (int)takenBy.size() && takenBy[c] == s)
+			c++;
+		if (c == (int)takenBy.size())
+			takenBy.push_back(-1);
+		color[s] = c;
+	}
+
+	// stable counting sort of the spring table by color
+	const int nColors = (int)takenBy.size();
+	colorStart.assign(nColors + 1, 0);
+	for (int s = 0; s < m; s++)
+		colorStart[color[s] + 1]++;
+	for (int c = 0; c < nColors; c++)
+		colorStart[c + 1] += colorStart[c];
+	std::vector<int> slot(colorStart.begin(), colorStart.end() - 1);
+	std::vector<int> a(m), b(m), order(m);
+	std::vector<double> L(m), k(m);
+	for (int s = 0; s < m; s++)
+	{
+		int t = slot[color[s]]++;
+		a[t] = springA[s]; b[t] = springB[s];
+		L[t] = restLength[s]; k[t] = springK[s];
+		order[t] = springOrder.empty() ? s : springOrder[s];
+	}
+	springA.swap(a); springB.swap(b);
+	restLength.swap(L); springK.swap(k);
+	springOrder.swap(order);
+	Modified();
+}
+
+bool ParticleSystem::ReuseNetwork(const ParticleSystem &previous)
+{
+	const int m = SpringCount();
+	if (!springOrder.empty() || ParticleCount() != previous.ParticleCount() || m != previous.SpringCount()
+		|| invMass != previous.invMass)
+		return false;
+	for (int t = 0; t < m; t++)
+	{
+		const int s = previous.springOrder.empty() ? t : previous.springOrder[t];
+		if (springA[s] != previous.springA[t] || springB[s] != previous.springB[t]
+			|| restLength[s] != previous.restLength[t] || springK[s] != previous.springK[t])
+			return false;
+	}
+	// the sizes match, so the copies reuse the storage
+	springA = previous.springA; springB = previous.springB;
+	restLength = previous.restLength; springK = previous.springK;
+	colorStart = previous.colorStart;
+	springOrder = previous.springOrder;
+	version = previous.version;
+	return true;
+}
+
+void ParticleSystem::ClearForces()
+{
+	const int n = ParticleCount();
+	for (int i = 0; i < n; i++)
+	{
+		fx[i] = 0.0;
+		fy[i] = 0.0;
+	}
+}
+
+void ParticleSystem::ForEachSpringBatch(const std::function<void(int, int)> &body)
+{
+	const int n = SpringCount();
+	if (!pool || pool->ThreadCount() < 2 || n < parallelSprings || !Colored())
+	{
+		body(0, n);
+		return;
+	}
+
+	// one color at a time, its springs touch every particle at most once
+	const int nColors = (int)colorStart.size() - 1;
+	for (int c = 0; c < nColors; c++)
+	{
+		const int count = colorStart[c + 1] - colorStart[c];
+		const int grain = count / (4 * pool->ThreadCount()) + 1;
+		pool->ParallelFor(colorStart[c], colorStart[c + 1], (grain > 1024) ? grain : 1024, body);
+	}
+}
+
+void ParticleSystem::AddSpringForces()
+{
+	ForEachSpringBatch([this](int first, int last) { AddSpringForces(first, last); });
+}
+
+void ParticleSystem::AddSpringForces(int first, int last)
+{
+	for (int s = first; s < last; s++)
+	{
+		const int a = springA[s];
+		const int b = springB[s];
+		double dx = x[b] - x[a];
+		double dy = y[b] - y[a];
+		double len = sqrt(dx * dx + dy * dy);
+		// Force on a, pointing towards b when stretched
+		double f = springK[s] * (len - restLength[s]) / len;
+		fx[a] += f * dx; fy[a] += f * dy;
+		fx[b] -= f * dx; fy[b] -= f * dy;
+	}
+}
+
+void ParticleSystem::AddDampingForces(double d)
+{
+	const int n = ParticleCount();
+	for (int i = 0; i < n; i++)
+	{
+		fx[i] -= d * vx[i];
+		fy[i] -= d * vy[i];
+	}
+}
+
+void ParticleSystem::AddContactForces()
+{
+	if (radius <= 0.0)
+		return;
+	PROFILE_SCOPE("Collision");
+
+	// cells of one diameter, so touching particles are in neighbouring cells
+	const double diameter = 2.0 * radius;
+	contacts.Build(x.data(), y.data(), ParticleCount(), diameter);
+	const double k = contactStiffness;
+	contacts.ForEachPair(diameter, [this, k, diameter](int i, int j, double dx, double dy, double dist2)
+	{
+		double dist = sqrt(dist2);
+		if (dist == 0.0)
+			return;
+		// push i away from j proportional to the overlap
+		double f = k * (diameter - dist) / dist;
+		fx[i] -= f * dx; fy[i] -= f * dy;
+		fx[j] += f * dx; fy[j] += f * dy;
+	});
+}
+
+void ParticleSystem::AddGroundPenalty(double height, double k)
+{
+	const int n = ParticleCount();
+	for (int i = 0; i < n; i++)
+	{
+		double penetration = y[i] - height;
+		if (penetration <= 0)
+			fy[i] -= k * penetration;
+	}
+}
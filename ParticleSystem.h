@@ -0,0 +1,106 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+#include "SpatialHash.h"
+
+class ThreadPool;
+
+// Mass points connected by springs, stored as structure-of-arrays so that the
+// integrators can stream over large networks.
+class ParticleSystem
+{
+public:
+	// Particle state
+	std::vector<double> x, y;
+	std::vector<double> vx, vy;
+	// Accumulated forces
+	std::vector<double> fx, fy;
+	// Inverse masses, 0 for fixed particles
+	std::vector<double> invMass;
+
+	// Spring table
+	std::vector<int> springA, springB;
+	std::vector<double> restLength;
+	std::vector<double> springK;
+	// Springs [colorStart[c], colorStart[c + 1]) share no particle, filled by
+	// ColorSprings
+	std::vector<int> colorStart;
+	// Index every spring had when it was added, filled by ColorSprings
+	std::vector<int> springOrder;
+
+	// Particle-particle contacts, disabled for radius 0
+	double radius;
+	double contactStiffness;
+	// Optional workers for the spring forces, may be null
+	ThreadPool *pool;
+
+public:
+	ParticleSystem(void) : radius(0.0), contactStiffness(100.0), pool(nullptr), version(NextVersion()) {}
+	~ParticleSystem(void) {}
+
+	int ParticleCount() const { return (int)x.size(); }
+	int SpringCount() const { return (int)springA.size(); }
+	bool IsFixed(int i) const { return invMass[i] == 0.0; }
+
+	void Clear();
+	void Reserve(int nParticles, int nSprings);
+
+	// Returns the index of the new particle
+	int AddParticle(double px, double py, double mass, bool fixed);
+	// Adds a spring whose rest length is the current distance of a and b
+	int AddSpring(int a, int b, double k);
+	int AddSpring(int a, int b, double k, double L);
+	// Greedily colors the spring graph and reorders the spring table by
+	// color. Invalidates spring indices returned by AddSpring.
+	void ColorSprings();
+	bool Colored() const { return !colorStart.empty() && colorStart.back() == SpringCount(); }
+	// For a network just rebuilt from scratch: if previous held the same
+	// masses and springs, possibly colored since, takes over its spring
+	// order, colors and version, so that solvers keep what they derived from
+	// it. Returns whether it did.
+	bool ReuseNetwork(const ParticleSystem &previous);
+
+	// Changes whenever particles or springs are added, removed or reordered,
+	// so solvers can tell whether data derived from the masses and the spring
+	// table is still valid. Copies share the version of their source. Code
+	// that writes invMass or the spring table directly calls Modified().
+	uint64_t Version() const { return version; }
+	void Modified() { version = NextVersion(); }
+
+	// Force accumulation
+	void ClearForces();
+	// Runs the colors in parallel on the pool once the springs are colored
+	// and there are enough of them. Every particle then receives its spring
+	// forces in table order, so the result is bitwise identical to the
+	// serial loop.
+	void AddSpringForces();
+	void AddDampingForces(double d);
+	void AddGroundPenalty(double height, double k);
+	// Penalty forces between particles closer than twice the radius
+	void AddContactForces();
+
+	// Calls body(first, last) over the whole spring table in table order.
+	// Once the springs are colored and there are enough of them, the springs
+	// of one color are split over the pool, so calls running at the same
+	// time never share a particle.
+	void ForEachSpringBatch(const std::function<void(int, int)> &body);
+
+	// Spring count below which the serial loop is faster
+	static const int parallelSprings = 16384;
+
+private:
+	void AddSpringForces(int first, int last);
+	// Unique over all particle systems, so that two systems never share a
+	// version by chance
+	static uint64_t NextVersion();
+
+	SpatialHash contacts;
+	uint64_t version;
+};
@@ -4,6 +4,7 @@
 //=============================================================================
 
 #include "Primitives.h"
+#include "ParticleSystem.h"
 #include "GL/glut.h"
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -12,46 +13,110 @@ const double dv = 3;
 const double thickness = 0.1;
 const int CDIVS = 32;
 
-// render a thick line
-void MSpring::render()
+// Coarser circles for large meshes, where points cover only a few pixels
+static int CircleDivisions(int nPoints)
 {
-	glColor3f(0.5, 0.5, 0.5);
-	glLineWidth(5);
-	glBegin(GL_LINES);
-	glVertex2d(a->pos.x() / dv, a->pos.y() / dv);
-	glVertex2d(b->pos.x() / dv, b->pos.y() / dv);
-	glEnd();
+	if (nPoints <= 4096)
+		return CDIVS;
+	if (nPoints <= 65536)
+		return CDIVS / 2;
+	return CDIVS / 4;
 }
 
-// render a circle using triangle fans
-void MPoint::render()
+void PrimitiveBatch::Build(const ParticleSystem &ps)
 {
-	static unsigned short counter = 0;
-	const float col[3][3] = { {1.0f, 0.0f, 0.0f}, {0.0f, 0.8f, 0.0f}, {0.0f, 0.0f, 1.0f} };
-
-	if (fixed)
-		glColor3f(0, 0, 1);
-	else {
-		const float *color = col[(counter++) % 3];
-		glColor3f(color[0], color[1], color[2]);
+	const int n = ps.ParticleCount();
+	const int m = ps.SpringCount();
+
+	divisions = CircleDivisions(n);
+	circle.resize(2 * divisions);
+	for (int i = 0; i < divisions; i++)
+	{
+		double ang = (double)i * M_PI * 2 / divisions;
+		circle[2 * i] = (float)(thickness * sin(ang) / dv);
+		circle[2 * i + 1] = (float)(thickness * cos(ang) / dv);
+	}
+
+	springIndices.resize(2 * m);
+	for (int s = 0; s < m; s++)
+	{
+		springIndices[2 * s] = ps.springA[s];
+		springIndices[2 * s + 1] = ps.springB[s];
+	}
+
+	// points cycle through red, green and blue, fixed points are blue
+	const unsigned char col[3][3] = { {255, 0, 0}, {0, 204, 0}, {0, 0, 255} };
+	const unsigned char fixedCol[3] = { 0, 0, 255 };
+	const int stride = divisions + 1;
+	discColors.resize(3 * stride * n);
+	discIndices.resize(3 * divisions * n);
+	for (int i = 0; i < n; i++)
+	{
+		const unsigned char *color = ps.IsFixed(i) ? fixedCol : col[i % 3];
+		for (int v = 0; v < stride; v++)
+			for (int c = 0; c < 3; c++)
+				discColors[3 * (i * stride + v) + c] = color[c];
+
+		const unsigned center = i * stride;
+		unsigned *tri = &discIndices[3 * divisions * i];
+		for (int v = 0; v < divisions; v++)
+		{
+			tri[3 * v] = center;
+			tri[3 * v + 1] = center + 1 + v;
+			tri[3 * v + 2] = center + 1 + (v + 1) % divisions;
+		}
+	}
+
+	nodes.resize(2 * n);
+	discVertices.resize(2 * stride * n);
+}
+
+void PrimitiveBatch::Update(const double *x, const double *y, int n)
+{
+	if ((int)nodes.size() != 2 * n)
+		return;
+
+	const int stride = divisions + 1;
+	for (int i = 0; i < n; i++)
+	{
+		const float px = (float)(x[i] / dv);
+		const float py = (float)(y[i] / dv);
+		nodes[2 * i] = px;
+		nodes[2 * i + 1] = py;
+
+		float *disc = &discVertices[2 * stride * i];
+		disc[0] = px;
+		disc[1] = py;
+		for (int v = 0; v < divisions; v++)
+		{
+			disc[2 * v + 2] = px + circle[2 * v];
+			disc[2 * v + 3] = py + circle[2 * v + 1];
+		}
+	}
+}
+
+void PrimitiveBatch::Render() const
+{
+	glEnableClientState(GL_VERTEX_ARRAY);
+
+	// springs as thick lines between the particle positions
+	if (!springIndices.empty())
+	{
+		glColor3f(0.5, 0.5, 0.5);
+		glLineWidth(5);
+		glVertexPointer(2, GL_FLOAT, 0, nodes.data());
+		glDrawElements(GL_LINES, (GLsizei)springIndices.size(), GL_UNSIGNED_INT, springIndices.data());
 	}
 
-	glBegin(GL_TRIANGLE_FAN);
-	double mx = pos.x();
-	double my = pos.y();
-	double r = 0.1;
-	double ox = mx;
-	double oy = my;
-	glVertex2d(mx / dv, my / dv);
-	for (int i = 0; i <= CDIVS; i++)
+	// points as filled circles
+	if (!discIndices.empty())
 	{
-		double ang = (double)i * M_PI * 2 / CDIVS;
-		double x = r*sin(ang) + mx;
-		double y = r*cos(ang) + my;
-		glVertex2d(ox / dv, oy / dv);
-		glVertex2d(x / dv, y / dv);
-		ox = x;
-		oy = y;
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(3, GL_UNSIGNED_BYTE, 0, discColors.data());
+		glVertexPointer(2, GL_FLOAT, 0, discVertices.data());
+		glDrawElements(GL_TRIANGLES, (GLsizei)discIndices.size(), GL_UNSIGNED_INT, discIndices.data());
+		glDisableClientState(GL_COLOR_ARRAY);
 	}
-	glEnd();
+
+	glDisableClientState(GL_VERTEX_ARRAY);
 }
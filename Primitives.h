@@ -5,32 +5,33 @@
 
 #pragma once
 
-#include "Utilities/Vector2T.h"
-#include <stdlib.h>
+#include <vector>
 
-class MPoint
-{
-public:
-	Vec2 pos;
-	bool fixed;
+class ParticleSystem;
 
+// Draws all springs and points of a particle system with a handful of vertex
+// array calls. Positions are refreshed once per frame in a single pass over
+// the particles, indices and colors only when the topology changes. Only
+// OpenGL 1.1 client arrays are used, so it runs on software GL as well.
+class PrimitiveBatch
+{
 public:
-	MPoint(double x, double y) { fixed = false; pos.x() = x; pos.y() = y; }
-	MPoint(void) { fixed = false; pos.x() = 0; pos.y() = 0; }
-	~MPoint(void){}
+	PrimitiveBatch(void) : divisions(0) {}
+	~PrimitiveBatch(void) {}
 
-	void render();
-};
+	// Rebuilds the index and color buffers for the current particles and springs
+	void Build(const ParticleSystem &ps);
+	// Copies the particle positions into the vertex buffers, n must match
+	// the particle count given to Build
+	void Update(const double *x, const double *y, int n);
+	void Render() const;
 
-class MSpring
-{
-public:
-	MPoint *a, *b;
-	
-public:
-	MSpring(void) : a(nullptr), b(nullptr) {}
-	~MSpring(void) {}
-	
-	void set(MPoint *_a, MPoint *_b) { a = _a; b = _b; }
-	void render();
+private:
+	int divisions;							// rim vertices per point
+	std::vector<float> circle;				// precomputed rim offsets (x, y)
+	std::vector<float> nodes;				// particle positions, for the springs
+	std::vector<unsigned> springIndices;
+	std::vector<float> discVertices;		// center followed by the rim per point
+	std::vector<unsigned char> discColors;
+	std::vector<unsigned> discIndices;
 };
@@ -0,0 +1,223 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	// Log-linear histogram: 16 sub-bins per power of two, values below 16 ns
+	// are exact. Percentiles are accurate to about 6%.
+	const int subBins = 16;
+	const int numBins = 64 * subBins;
+
+	int BinOf(int64_t ns)
+	{
+		if (ns < subBins)
+			return (ns < 0) ? 0 : (int)ns;
+#if defined(__GNUC__)
+		int e = 63 - __builtin_clzll((unsigned long long)ns);
+#else
+		int e = 63;
+		while (!(ns >> e))
+			e--;
+#endif
+		return (e - 3) * subBins + (int)((ns >> (e - 4)) & (subBins - 1));
+	}
+
+	// Middle of the range covered by a bin
+	double BinValue(int bin)
+	{
+		if (bin < subBins)
+			return bin;
+		int e = bin / subBins + 3;
+		double low = (double)(subBins + bin % subBins) * (double)(1ll << (e - 4));
+		return low + 0.5 * (double)(1ll << (e - 4));
+	}
+
+	struct Stage
+	{
+		const char *name;
+		uint64_t count;
+		double total;
+		int64_t max;
+		std::vector<uint64_t> bins;
+
+		explicit Stage(const char *_name) : name(_name), count(0), total(0.0), max(0), bins(numBins, 0) {}
+	};
+
+	struct Event
+	{
+		const char *name;
+		int64_t begin;
+		int64_t duration;
+	};
+
+	struct ThreadLog
+	{
+		int id;
+		uint64_t dropped;
+		std::vector<Event> events;
+		std::vector<Stage> stages;
+	};
+
+	std::mutex registryLock;
+	std::vector<std::unique_ptr<ThreadLog>> registry;
+	thread_local ThreadLog *threadLog = nullptr;
+
+	ThreadLog *CurrentLog()
+	{
+		if (!threadLog)
+		{
+			std::lock_guard<std::mutex> guard(registryLock);
+			registry.push_back(std::unique_ptr<ThreadLog>(new ThreadLog()));
+			threadLog = registry.back().get();
+			threadLog->id = (int)registry.size();
+			threadLog->dropped = 0;
+		}
+		return threadLog;
+	}
+
+	void WriteEscaped(FILE *file, const char *s)
+	{
+		for (; *s; s++)
+		{
+			if (*s == '"' || *s == '\\')
+				fputc('\\', file);
+			fputc(*s, file);
+		}
+	}
+}
+
+void Profiler::Record(const char *name, int64_t begin, int64_t end)
+{
+	ThreadLog *log = CurrentLog();
+	const int64_t duration = end - begin;
+
+	// few stages per thread, the literals compare by address
+	Stage *stage = nullptr;
+	for (size_t i = 0; i < log->stages.size(); i++)
+		if (log->stages[i].name == name)
+		{
+			stage = &log->stages[i];
+			break;
+		}
+	if (!stage)
+	{
+		log->stages.push_back(Stage(name));
+		stage = &log->stages.back();
+	}
+	stage->count++;
+	stage->total += (double)duration;
+	stage->max = std::max(stage->max, duration);
+	stage->bins[BinOf(duration)]++;
+
+	if ((int)log->events.size() < maxEventsPerThread)
+	{
+		Event event = { name, begin, duration };
+		log->events.push_back(event);
+	}
+	else
+		log->dropped++;
+}
+
+bool Profiler::Empty()
+{
+	std::lock_guard<std::mutex> guard(registryLock);
+	for (size_t t = 0; t < registry.size(); t++)
+		if (!registry[t]->stages.empty())
+			return false;
+	return true;
+}
+
+bool Profiler::WriteTrace(const char *fileName)
+{
+	FILE *file = fopen(fileName, "w");
+	if (!file)
+		return false;
+
+	std::lock_guard<std::mutex> guard(registryLock);
+	int64_t origin = INT64_MAX;
+	for (size_t t = 0; t < registry.size(); t++)
+		for (size_t i = 0; i < registry[t]->events.size(); i++)
+			origin = std::min(origin, registry[t]->events[i].begin);
+
+	// complete events ("X") with microsecond timestamps
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	bool first = true;
+	for (size_t t = 0; t < registry.size(); t++)
+	{
+		const ThreadLog &log = *registry[t];
+		for (size_t i = 0; i < log.events.size(); i++)
+		{
+			const Event &e = log.events[i];
+			fprintf(file, first ? "\n{\"name\":\"" : ",\n{\"name\":\"");
+			WriteEscaped(file, e.name);
+			fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				log.id, (e.begin - origin) * 1e-3, e.duration * 1e-3);
+			first = false;
+		}
+	}
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
+
+void Profiler::PrintSummary(std::ostream &os)
+{
+	std::lock_guard<std::mutex> guard(registryLock);
+
+	// merge the stages of all threads by name
+	std::vector<Stage> merged;
+	uint64_t dropped = 0;
+	for (size_t t = 0; t < registry.size(); t++)
+	{
+		dropped += registry[t]->dropped;
+		for (size_t s = 0; s < registry[t]->stages.size(); s++)
+		{
+			const Stage &stage = registry[t]->stages[s];
+			size_t m = 0;
+			while (m < merged.size() && strcmp(merged[m].name, stage.name))
+				m++;
+			if (m == merged.size())
+				merged.push_back(Stage(stage.name));
+			merged[m].count += stage.count;
+			merged[m].total += stage.total;
+			merged[m].max = std::max(merged[m].max, stage.max);
+			for (int b = 0; b < numBins; b++)
+				merged[m].bins[b] += stage.bins[b];
+		}
+	}
+
+	const double quantiles[3] = { 0.5, 0.9, 0.99 };
+	char line[256];
+	snprintf(line, sizeof(line), "%-12s %10s %12s %10s %10s %10s %10s %12s",
+		"stage", "count", "total [ms]", "mean [us]", "p50 [us]", "p90 [us]", "p99 [us]", "max [us]");
+	os << line << std::endl;
+	for (size_t m = 0; m < merged.size(); m++)
+	{
+		const Stage &stage = merged[m];
+		double q[3];
+		for (int i = 0; i < 3; i++)
+		{
+			uint64_t rank = (uint64_t)(quantiles[i] * (double)(stage.count - 1));
+			uint64_t seen = 0;
+			int b = 0;
+			while (seen + stage.bins[b] <= rank)
+				seen += stage.bins[b++];
+			q[i] = BinValue(b);
+		}
+		snprintf(line, sizeof(line), "%-12s %10llu %12.3f %10.3f %10.3f %10.3f %10.3f %12.3f",
+			stage.name, (unsigned long long)stage.count, stage.total * 1e-6, stage.total / stage.count * 1e-3,
+			q[0] * 1e-3, q[1] * 1e-3, q[2] * 1e-3, stage.max * 1e-3);
+		os << line << std::endl;
+	}
+	if (dropped)
+		os << dropped << " events exceeded the per-thread trace buffer and are only in the summary" << std::endl;
+}
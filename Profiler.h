@@ -0,0 +1,60 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Scoped timers for the hot paths. PROFILE_SCOPE("name") records the time
+// until the end of the enclosing block; the name must be a string literal.
+// Without ENABLE_PROFILING (CMake option of the same name) the macro expands
+// to nothing.
+//
+// Every thread records into its own buffer, so recording takes no lock.
+// Durations also go into per-stage histograms that cover the whole run, the
+// trace itself keeps the first maxEventsPerThread events of every thread.
+namespace Profiler
+{
+	const int maxEventsPerThread = 1 << 20;
+
+	inline int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void Record(const char *name, int64_t begin, int64_t end);
+
+	// Writes all events in the Chrome/Perfetto trace JSON format, returns
+	// false if the file cannot be written
+	bool WriteTrace(const char *fileName);
+	// Count, mean and percentiles per stage
+	void PrintSummary(std::ostream &os);
+	bool Empty();
+}
+
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer(const char *_name) : name(_name), begin(Profiler::Now()) {}
+	~ScopedTimer(void) { Profiler::Record(name, begin, Profiler::Now()); }
+
+private:
+	ScopedTimer(const ScopedTimer &);
+	ScopedTimer &operator=(const ScopedTimer &);
+
+	const char *name;
+	int64_t begin;
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#ifdef ENABLE_PROFILING
+#define PROFILE_SCOPE(name) ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
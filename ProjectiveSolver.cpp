@@ -0,0 +1,181 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "ProjectiveSolver.h"
+#include "Exercise.h"
+#include "Profiler.h"
+#include <math.h>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+void ProjectiveDynamicsSolver::Prepare(const ParticleSystem &ps, double _dt)
+{
+	if (ps.Version() != version || dt != _dt)
+	{
+		PROFILE_SCOPE("Factor");
+		Factor(ps, _dt);
+	}
+}
+
+void ProjectiveDynamicsSolver::Factor(const ParticleSystem &ps, double _dt)
+{
+	const int n = ps.ParticleCount();
+	const int nSprings = ps.SpringCount();
+	dt = _dt;
+
+	// entries of every column, duplicates are summed below
+	std::vector<std::vector<std::pair<int, double> > > columns(n);
+	const double invDt2 = 1.0 / (dt * dt);
+	for (int i = 0; i < n; i++)
+		columns[i].push_back(std::make_pair(i, ps.IsFixed(i) ? 1.0 : invDt2 / ps.invMass[i]));
+	couplingRow.clear();
+	couplingFixed.clear();
+	couplingValue.clear();
+	for (int s = 0; s < nSprings; s++)
+	{
+		const int a = ps.springA[s], b = ps.springB[s];
+		const double k = ps.springK[s];
+		const bool fixedA = ps.IsFixed(a), fixedB = ps.IsFixed(b);
+		if (!fixedA)
+			columns[a].push_back(std::make_pair(a, k));
+		if (!fixedB)
+			columns[b].push_back(std::make_pair(b, k));
+		if (!fixedA && !fixedB)
+		{
+			columns[a].push_back(std::make_pair(b, -k));
+			columns[b].push_back(std::make_pair(a, -k));
+		}
+		else if (fixedA != fixedB)
+		{
+			couplingRow.push_back(fixedA ? b : a);
+			couplingFixed.push_back(fixedA ? a : b);
+			couplingValue.push_back(-k);
+		}
+	}
+
+	std::vector<int> colStart(n + 1), rows;
+	std::vector<double> values;
+	for (int j = 0; j < n; j++)
+	{
+		std::vector<std::pair<int, double> > &c = columns[j];
+		std::sort(c.begin(), c.end());
+		colStart[j] = (int)rows.size();
+		for (size_t e = 0; e < c.size(); e++)
+		{
+			if (e > 0 && c[e].first == c[e - 1].first)
+				values.back() += c[e].second;
+			else
+			{
+				rows.push_back(c[e].first);
+				values.push_back(c[e].second);
+			}
+		}
+	}
+	colStart[n] = (int)rows.size();
+
+	if (!factor.Factor(n, colStart, rows, values))
+		throw std::invalid_argument("projective dynamics: system matrix is not positive definite");
+
+	sx.resize(n); sy.resize(n);
+	rhsX.resize(n); rhsY.resize(n);
+	projX.assign(nSprings, 0.0); projY.assign(nSprings, 0.0);
+	version = ps.Version();
+}
+
+void ProjectiveDynamicsSolver::BuildRhs(const ParticleSystem &ps, const std::vector<double> &s, const std::vector<double> &pos,
+	const std::vector<double> &proj, std::vector<double> &rhs) const
+{
+	const int n = ps.ParticleCount();
+	const int nSprings = ps.SpringCount();
+	const double invDt2 = 1.0 / (dt * dt);
+	for (int i = 0; i < n; i++)
+		rhs[i] = ps.IsFixed(i) ? pos[i] : invDt2 / ps.invMass[i] * s[i];
+	// G_s^T d_s with G_s x = x_b - x_a
+	for (int j = 0; j < nSprings; j++)
+	{
+		const double f = ps.springK[j] * proj[j];
+		const int a = ps.springA[j], b = ps.springB[j];
+		if (!ps.IsFixed(a))
+			rhs[a] -= f;
+		if (!ps.IsFixed(b))
+			rhs[b] += f;
+	}
+	for (size_t c = 0; c < couplingRow.size(); c++)
+		rhs[couplingRow[c]] -= couplingValue[c] * pos[couplingFixed[c]];
+}
+
+void ProjectiveDynamicsSolver::Step(ParticleSystem &ps, double d, double _dt)
+{
+	const int n = ps.ParticleCount();
+	Prepare(ps, _dt);
+
+	// predict with everything but the springs and the ground
+	{
+		PROFILE_SCOPE("Forces");
+		ps.ClearForces();
+		ps.AddDampingForces(d);
+	}
+	ps.AddContactForces();
+
+	{
+		PROFILE_SCOPE("Integrate");
+		prevX = ps.x;
+		prevY = ps.y;
+		for (int i = 0; i < n; i++)
+		{
+			const double w = ps.invMass[i];
+			sx[i] = ps.x[i];
+			sy[i] = ps.y[i];
+			if (w == 0.0)
+				continue;
+			sx[i] += dt * (ps.vx[i] + dt * w * ps.fx[i]);
+			sy[i] += dt * (ps.vy[i] + dt * (w * ps.fy[i] - gravity));
+			ps.x[i] = sx[i];
+			ps.y[i] = sy[i];
+		}
+	}
+
+	PROFILE_SCOPE("Solve");
+	for (int it = 0; it < iterations; it++)
+	{
+		// local: closest spring vector of rest length
+		ps.ForEachSpringBatch([this, &ps](int first, int last)
+		{
+			for (int s = first; s < last; s++)
+			{
+				const double dx = ps.x[ps.springB[s]] - ps.x[ps.springA[s]];
+				const double dy = ps.y[ps.springB[s]] - ps.y[ps.springA[s]];
+				const double len = sqrt(dx * dx + dy * dy);
+				// coincident ends keep their previous direction
+				if (len == 0.0)
+					continue;
+				projX[s] = ps.restLength[s] * dx / len;
+				projY[s] = ps.restLength[s] * dy / len;
+			}
+		});
+
+		// global: prefactored solve of both coordinates
+		BuildRhs(ps, sx, ps.x, projX, rhsX);
+		BuildRhs(ps, sy, ps.y, projY, rhsY);
+		factor.Solve(rhsX.data(), rhsY.data());
+		for (int i = 0; i < n; i++)
+		{
+			if (ps.IsFixed(i))
+				continue;
+			ps.x[i] = rhsX[i];
+			ps.y[i] = (rhsY[i] < groundHeight) ? groundHeight : rhsY[i];
+		}
+	}
+
+	const double invDt = 1.0 / dt;
+	for (int i = 0; i < n; i++)
+	{
+		if (ps.IsFixed(i))
+			continue;
+		ps.vx[i] = (ps.x[i] - prevX[i]) * invDt;
+		ps.vy[i] = (ps.y[i] - prevY[i]) * invDt;
+	}
+}
@@ -0,0 +1,61 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <vector>
+#include "ParticleSystem.h"
+#include "SparseCholesky.h"
+
+// Projective dynamics for spring networks (Liu et al. 2013, Bouaziz et al.
+// 2014). A step minimizes the implicit Euler energy
+//   |M^1/2 (x - s)|^2 / (2 dt^2) + sum_s k_s / 2 |x_b - x_a - d_s|^2
+// over the positions x and the spring directions d_s of rest length, with
+// s the prediction from the external forces. The local step projects every
+// spring onto its rest length, the global step solves
+//   (M / dt^2 + sum_s k_s G_s^T G_s) x = M s / dt^2 + sum_s k_s G_s^T d_s
+// for the x and the y coordinates. The matrix only depends on the masses,
+// the spring graph and dt, so its Cholesky factor is computed once and every
+// global step is two triangular solves per coordinate. The factor is
+// recomputed when any of these change.
+//
+// Fixed particles keep their row as an identity, their coupling to free
+// particles moves to the right-hand side. Contacts enter the prediction, the
+// ground is a hard constraint like in XPBDSolver.
+class ProjectiveDynamicsSolver
+{
+public:
+	// Local/global iterations per step
+	int iterations;
+
+	ProjectiveDynamicsSolver(void) : iterations(10), dt(0.0), version(0) {}
+
+	// Factors the system matrix for ps and dt unless the cached factor
+	// already fits them, i.e. was computed for the same dt and version of
+	// the particle system
+	void Prepare(const ParticleSystem &ps, double dt);
+	void Step(ParticleSystem &ps, double d, double dt);
+
+	const SparseCholesky &Factorization() const { return factor; }
+
+private:
+	void Factor(const ParticleSystem &ps, double dt);
+	// Right-hand side of one coordinate: inertia, the projected springs and
+	// the fixed particles
+	void BuildRhs(const ParticleSystem &ps, const std::vector<double> &s, const std::vector<double> &pos,
+		const std::vector<double> &proj, std::vector<double> &rhs) const;
+
+	SparseCholesky factor;
+	// inputs of the current factor
+	double dt;
+	uint64_t version;
+	// free-fixed couplings: rhs[couplingRow] -= couplingValue * pos[couplingFixed]
+	std::vector<int> couplingRow, couplingFixed;
+	std::vector<double> couplingValue;
+
+	// prediction, positions at the start of the step, projected spring
+	// vectors and right-hand sides
+	std::vector<double> sx, sy, prevX, prevY, projX, projY, rhsX, rhsY;
+};
@@ -6,10 +6,15 @@
 #include "Scene.h"
 #include "Primitives.h"
 #include "Utilities/Vector2T.h"
+#include "Sweep.h"
+#include "Exercise.h"
+#include "Integrators.h"
+#include "Profiler.h"
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <cstring>
 #include <stdio.h>
+#include <stdexcept>
 
 #ifdef WIN32
 #include "GL\glut.h"
@@ -18,32 +23,38 @@
 #include <OpenGL/gl.h>
 #include <OpenGL/OpenGL.h>
 #include <GLUT/glut.h>
+#else
+#include "GL/glut.h"
 #endif
 
 #include <iostream>
 using namespace std;
 
-double Scene::step = 0.01f;
-double Scene::mass = 1.0;
-double Scene::stiffness = 10.0;
-double Scene::damping = 0.01f;
+const char *methodNames[METHODS_NUM] = { "invalid", "euler", "symplectic_euler", "midpoint", "backwards_euler", "analytic", "implicit_euler", "adaptive_rk23", "rk4", "velocity_verlet", "xpbd", "projective_dynamics" };
+const char *testcaseNames[TESTCASES_NUM] = { "invalid", "spring1d", "falling", "error_measurement", "stability_measurement", "cloth", "work_precision" };
 
-int Scene::xPoints = 5;
-int Scene::yPoints = 5;
-int Scene::zPoints = 5;
-double Scene::xSize = 1.0;
-double Scene::ySize = 1.0;
-double Scene::zSize = 1.0;
+bool Scene::IsMeasurement(Testcase testcase)
+{
+	return testcase == ERROR_MEASUREMENT || testcase == STABILITY_MEASUREMENT || testcase == WORK_PRECISION;
+}
 
-extern void AdvanceTimeStep1(double k, double m, double d, double L, double dt, int method, double p1, double v1, double& p2, double& v2);
-extern void AdvanceTimeStep3(double k, double m, double d, double L, double dt, Vec2& p1, Vec2& v1, Vec2& p2, Vec2& v2, Vec2& p3, Vec2& v3);
+bool Scene::Supports(Testcase testcase, Method method)
+{
+	if (IsMeasurement(testcase))
+		return true;
+	if (method <= INVALID_METHOD || method >= METHODS_NUM)
+		return false;
+	return testcase == SPRING1D || method != ANALYTIC;
+}
 
-#define METHODS_NUM 6
-#define TESTCASES_NUM 5
-Scene::Method Scene::method = BACK_EULER;
-char *methodNames[METHODS_NUM] = { "invalid", "euler", "symplectic_euler", "midpoint", "backwards_euler", "analytic" };
-Scene::Testcase Scene::testcase = SPRING1D;
-char *testcaseNames[TESTCASES_NUM] = { "invalid", "spring1d", "falling", "error_measurement", "stability_measurement" };
+Scene::Config::Config(void) : testcase(SPRING1D), method(BACK_EULER),
+	xPoints(5), yPoints(5), zPoints(5), xSize(1.0), ySize(1.0), zSize(1.0),
+	step(0.01f), mass(1.0), stiffness(10.0), damping(0.01f),
+	headless(false), numSteps(1000), outStride(1), outDouble(false),
+	radius(0.1), numThreads(0), rtol(1e-6), atol(1e-9),
+	solverIterations(10), tolerance(1e-4)
+{
+}
 
 Scene::Scene(void)
 {
@@ -51,33 +62,46 @@ Scene::Scene(void)
 	PrintSettings();
 }
 
+Scene::Scene(int argc, char* argv[]) : config(ParseArguments(argc, argv))
+{
+	PrintSettings();
+	Init();
+}
+
+Scene::Scene(const Config &_config) : config(_config)
+{
+	Init();
+}
+
 // some default call: -testcase hanging -method Euler -stiff 10 -mass 0.1 -step 0.003 -damp 0.01
 
-Scene::Scene(int argc, char* argv[])
+Scene::Config Scene::ParseArguments(int argc, char* argv[])
 {
+	Config config;
 	//  defaults:
-	testcase = FALLING;
-	method = ANALYTIC;
-	stiffness = 10.0;
-	mass = 0.1f;
-	step = 0.01f;
-	damping = 0.01f;
+	config.testcase = FALLING;
+	config.method = ANALYTIC;
+	config.stiffness = 10.0;
+	config.mass = 0.1f;
+	config.step = 0.01f;
+	config.damping = 0.01f;
 
+	bool methodGiven = false;
 	int arg = 1;
 	while (arg < argc)
 	{
 		// Testcase
 		if (!strcmp(argv[arg], "-testcase"))
 		{
-			testcase = INVALID_TESTCASE;
+			config.testcase = INVALID_TESTCASE;
 			arg++;
 
 			for (int i = 1; i < TESTCASES_NUM; i++)
 				if (!strcmp(argv[arg], testcaseNames[i]))
 				{
-					testcase = (Testcase)i;
+					config.testcase = (Testcase)i;
 				}
-			if (testcase == INVALID_TESTCASE)
+			if (config.testcase == INVALID_TESTCASE)
 			{
 				cerr << "Unrecognized testcase " << argv[arg] << endl;
 				exit(1);
@@ -88,47 +112,132 @@ Scene::Scene(int argc, char* argv[])
 		else if (!strcmp(argv[arg], "-method"))
 		{
 			arg++;
-			method = INVALID_METHOD;
+			config.method = INVALID_METHOD;
 			for (int i = 1; i < METHODS_NUM; i++)
 				if (!strcmp(argv[arg], methodNames[i]))
-					method = (Method)i;
-			if (method == INVALID_METHOD && testcase != ERROR_MEASUREMENT && testcase != STABILITY_MEASUREMENT)
+					config.method = (Method)i;
+			if (config.method == INVALID_METHOD && !IsMeasurement(config.testcase))
 			{
 				cerr << "Unrecognized method " << argv[arg] << endl;
 				exit(1);
 			}
+			methodGiven = true;
 			arg++;
 		}
-		// Object size
+		// Object size (grid points of the cloth)
 		else if (!strcmp(argv[arg], "-size"))
 		{
-			xPoints = atoi(argv[++arg]);
-			yPoints = atoi(argv[++arg]);
-			zPoints = atoi(argv[++arg]);
+			config.xPoints = atoi(argv[++arg]);
+			config.yPoints = atoi(argv[++arg]);
+			config.zPoints = atoi(argv[++arg]);
 			arg++;
 		}
 		// Step size
 		else if (!strcmp(argv[arg], "-step"))
 		{
-			step = (double)atof(argv[++arg]);
+			config.step = (double)atof(argv[++arg]);
 			arg++;
 		}
 		// Stiffness
 		else if (!strcmp(argv[arg], "-stiff"))
 		{
-			stiffness = (double)atof(argv[++arg]);
+			config.stiffness = (double)atof(argv[++arg]);
 			arg++;
 		}
 		// Damping
 		else if (!strcmp(argv[arg], "-damp"))
 		{
-			damping = (double)atof(argv[++arg]);
+			config.damping = (double)atof(argv[++arg]);
 			arg++;
 		}
 		// Mass
 		else if (!strcmp(argv[arg], "-mass"))
 		{
-			mass = (double)atof(argv[++arg]);
+			config.mass = (double)atof(argv[++arg]);
+			arg++;
+		}
+		// Headless batch mode
+		else if (!strcmp(argv[arg], "-headless"))
+		{
+			config.headless = true;
+			arg++;
+		}
+		// Number of steps in headless mode
+		else if (!strcmp(argv[arg], "-steps"))
+		{
+			config.numSteps = atoi(argv[++arg]);
+			arg++;
+		}
+		// Binary trajectory output
+		else if (!strcmp(argv[arg], "-out"))
+		{
+			config.outFile = argv[++arg];
+			arg++;
+		}
+		else if (!strcmp(argv[arg], "-stride"))
+		{
+			config.outStride = atoi(argv[++arg]);
+			arg++;
+		}
+		else if (!strcmp(argv[arg], "-precision"))
+		{
+			arg++;
+			if (!strcmp(argv[arg], "double"))
+				config.outDouble = true;
+			else if (!strcmp(argv[arg], "single"))
+				config.outDouble = false;
+			else
+			{
+				cerr << "Unrecognized precision " << argv[arg] << endl;
+				exit(1);
+			}
+			arg++;
+		}
+		// Contact radius
+		else if (!strcmp(argv[arg], "-radius"))
+		{
+			config.radius = (double)atof(argv[++arg]);
+			arg++;
+		}
+		// Worker threads for the measurement sweeps
+		else if (!strcmp(argv[arg], "-threads"))
+		{
+			config.numThreads = atoi(argv[++arg]);
+			arg++;
+		}
+		// Tolerances of the adaptive method
+		else if (!strcmp(argv[arg], "-rtol"))
+		{
+			config.rtol = (double)atof(argv[++arg]);
+			arg++;
+		}
+		else if (!strcmp(argv[arg], "-atol"))
+		{
+			config.atol = (double)atof(argv[++arg]);
+			arg++;
+		}
+		// Iterations of the XPBD and projective dynamics solvers
+		else if (!strcmp(argv[arg], "-iterations"))
+		{
+			config.solverIterations = atoi(argv[++arg]);
+			arg++;
+		}
+		// Target error of the work-precision testcase
+		else if (!strcmp(argv[arg], "-tol"))
+		{
+			config.tolerance = (double)atof(argv[++arg]);
+			arg++;
+		}
+		// Profiler trace
+		else if (!strcmp(argv[arg], "-trace"))
+		{
+			config.traceFile = argv[++arg];
+			arg++;
+		}
+		// Methods to run side by side
+		else if (!strcmp(argv[arg], "-batch"))
+		{
+			config.batch = argv[++arg];
 			arg++;
 		}
 		// Others
@@ -148,14 +257,35 @@ Scene::Scene(int argc, char* argv[])
 			cerr << methodNames[METHODS_NUM - 1] << "]" << endl;
 			cerr << "\t-step [step size in secs]" << endl;
 			cerr << "\t-stiff [stiffness value]" << endl;
-			cerr << "\t-damp [damping value]" << endl << endl;
+			cerr << "\t-damp [damping value]" << endl;
+			cerr << "\t-size [x y z points of the cloth, z is ignored]" << endl;
+			cerr << "\t-headless (run without a window)" << endl;
+			cerr << "\t-steps [number of steps in headless mode]" << endl;
+			cerr << "\t-out [binary trajectory file]" << endl;
+			cerr << "\t-stride [write every n-th step to the trajectory]" << endl;
+			cerr << "\t-precision [single,double]" << endl;
+			cerr << "\t-radius [particle contact radius, 0 = no contacts]" << endl;
+			cerr << "\t-threads [worker threads for measurements and large networks, 0 = all cores]" << endl;
+			cerr << "\t-rtol [relative tolerance of adaptive_rk23]" << endl;
+			cerr << "\t-atol [absolute tolerance of adaptive_rk23]" << endl;
+			cerr << "\t-iterations [xpbd sweeps or projective dynamics iterations per step]" << endl;
+			cerr << "\t-tol [target error of the work-precision testcase]" << endl;
+			cerr << "\t-trace [Chrome trace file, needs ENABLE_PROFILING]" << endl;
+			cerr << "\t-batch [comma-separated methods run in one headless process]" << endl << endl;
 			exit(1);
 			break;
 		}
 	}
 
-	PrintSettings();
-	Init();
+	// the spring networks default to backwards_euler, AdvanceTimeStep3
+	if (!methodGiven && !Supports(config.testcase, config.method))
+		config.method = BACK_EULER;
+	if (!Supports(config.testcase, config.method))
+	{
+		cerr << "Method " << methodNames[config.method] << " has no integrator for the " << testcaseNames[config.testcase] << " testcase" << endl;
+		exit(1);
+	}
+	return config;
 }
 
 Scene::~Scene(void)
@@ -165,145 +295,417 @@ Scene::~Scene(void)
 void Scene::PrintSettings(void)
 {
 	cerr << endl << "Current Settings:" << endl;
-	cerr << "\t-testcase " << testcaseNames[(int)testcase] << endl;
-	cerr << "\t-method " << methodNames[(int)method] << endl;
-	cerr << "\t-mass " << mass << endl;
-	cerr << "\t-step " << step << endl;
-	cerr << "\t-stiff " << stiffness << endl;
-	cerr << "\t-damp " << damping << endl << endl;
+	cerr << "\t-testcase " << testcaseNames[(int)config.testcase] << endl;
+	cerr << "\t-method " << methodNames[(int)config.method] << endl;
+	cerr << "\t-mass " << config.mass << endl;
+	cerr << "\t-step " << config.step << endl;
+	cerr << "\t-stiff " << config.stiffness << endl;
+	cerr << "\t-damp " << config.damping << endl << endl;
+}
+
+void Scene::PrintStatistics(void)
+{
+	if (config.method != ADAPTIVE_RK23 || IsMeasurement(config.testcase))
+		return;
+	long accepted = (config.testcase == SPRING1D) ? spring1.accepted : adaptiveSolver.accepted;
+	long rejected = (config.testcase == SPRING1D) ? spring1.rejected : adaptiveSolver.rejected;
+	double h = (config.testcase == SPRING1D) ? spring1.h : adaptiveSolver.h;
+	cerr << methodNames[config.method] << ": " << accepted << " accepted, " << rejected << " rejected steps, next step " << h << endl;
 }
 
 void Scene::Init(void)
 {
+	if (!Supports(config.testcase, config.method))
+		throw std::invalid_argument(std::string("Method chosen has no integrator for the ") + testcaseNames[config.testcase] + " testcase");
+
 	// Animation settings
+	time = 0.0;
 	pause = false;
+	finished = false;
 
-	// Create points & springs
-	nPoints = 3; nSprings = 3;
-	if ((testcase == SPRING1D) || (testcase == ERROR_MEASUREMENT) || testcase == STABILITY_MEASUREMENT)
+	// Create particles & springs
+	particles.Clear();
+	if (config.testcase == SPRING1D || IsMeasurement(config.testcase))
 	{
-		nPoints = 2; nSprings = 1;
+		// Mass point hanging from a fixed point
+		int a = particles.AddParticle(0.0, 0.0, config.mass, true);
+		int b = particles.AddParticle(0.0, -1.0, config.mass, false);
+		particles.AddSpring(a, b, config.stiffness);
 	}
-
-	// Allocate vector
-	for (int i = 0; i < nPoints; i++)
-		points.push_back(MPoint());
-
-	Vec2 c(0.0, 0.0);
-	Vec2 zero(0.0, 0.0);
-	p1 = c + Vec2(0, 1);
-	p2 = c + Vec2(cos(210.0 / 180.0 * M_PI), sin(210.0 / 180.0 * M_PI));
-	p3 = c + Vec2(cos(330.0 / 180.0 * M_PI), sin(330.0 / 180.0 * M_PI));
-	v1 = v2 = v3 = zero;
-	L = (p1 - p2).length();
-	if (testcase == SPRING1D || testcase == ERROR_MEASUREMENT || testcase == STABILITY_MEASUREMENT)
+	else if (config.testcase == CLOTH)
 	{
-		p1 = 0.0*c;
-		p2 = p1 + Vec2(0, -1);
-		L = (p1 - p2).length();
+		CreateCloth(particles, config);
 	}
+	else
+	{
+		// Free falling triangle
+		int a = particles.AddParticle(0.0, 1.0, config.mass, false);
+		int b = particles.AddParticle(cos(210.0 / 180.0 * M_PI), sin(210.0 / 180.0 * M_PI), config.mass, false);
+		int c = particles.AddParticle(cos(330.0 / 180.0 * M_PI), sin(330.0 / 180.0 * M_PI), config.mass, false);
+		particles.AddSpring(a, b, config.stiffness);
+		particles.AddSpring(b, c, config.stiffness);
+		particles.AddSpring(c, a, config.stiffness);
+	}
+	// Large networks assemble their spring forces in parallel, one color
+	// of independent springs at a time. Scenes limited to one thread, e.g.
+	// those of a SceneBatch, keep the same spring order but stay on the
+	// calling thread. A Reset to the same network keeps the colors.
+	if (!particles.ReuseNetwork(network))
+	{
+		if (particles.SpringCount() >= ParticleSystem::parallelSprings)
+			particles.ColorSprings();
+		network = particles;
+	}
+	if (particles.Colored())
+	{
+		if (!workers && config.numThreads != 1)
+			workers.reset(new ThreadPool(config.numThreads));
+		particles.pool = workers.get();
+	}
+	nPoints = particles.ParticleCount();
+	nSprings = particles.SpringCount();
+	if (config.testcase == FALLING)
+		particles.radius = config.radius;
+	else if (config.testcase != CLOTH)
+		particles.radius = 0.0;
 
-	points[0].pos = p1;
-	points[0].fixed = true;
-	points[1].pos = p2;
-	if (nPoints > 2)
-		points[2].pos = p3;
-	if (testcase == FALLING)
-		points[0].fixed = false;
-
-	// Allocate vector
-	for (int i = 0; i < nSprings; i++)
-		springs.push_back(MSpring());
+	// The 1D spring remembers its initial conditions for the analytic solution
+	spring1 = Spring1State(particles.y[1], particles.vy[1]);
+	spring1.rtol = adaptiveSolver.rtol = config.rtol;
+	spring1.atol = adaptiveSolver.atol = config.atol;
+	adaptiveSolver.h = 0.0;
+	adaptiveSolver.accepted = adaptiveSolver.rejected = 0;
+	xpbdSolver.iterations = projectiveSolver.iterations = config.solverIterations;
+	// the projective dynamics factor is reused until the network changes
+	if (config.method == PROJECTIVE_DYNAMICS && (config.testcase == FALLING || config.testcase == CLOTH))
+		projectiveSolver.Prepare(particles, config.step);
+	spring1Kernel = (config.testcase == SPRING1D) ? SelectKernel<Spring1Run>(config.method) : nullptr;
+	OpenOutput();
 
-	springs[0].set(&points[0], &points[1]);
-	if (nPoints > 2)
+	if (!config.headless)
 	{
-		springs[1].set(&points[1], &points[2]);
-		springs[2].set(&points[2], &points[0]);
+		batch.Build(particles);
+		Publish();
 	}
 }
 
-void Scene::timeStepReductionLoop(double stiffness, double mass, double damping, double L, double step, int numofIterations)
+void Scene::Reset(void)
 {
-	double currstep = step;
+	Init();
+}
 
-	cout << "velocity change table:" << endl;
-	cout << "step ";
-	for (int m = 1; m <= 5; m++)
-		cout << methodNames[m] << " ";
-	cout << endl;
+void Scene::Reset(const Parameters &p)
+{
+	if (p.method <= INVALID_METHOD || p.method >= METHODS_NUM || !Supports(config.testcase, p.method))
+		throw std::invalid_argument("Method chosen is invalid");
+	config.method = p.method;
+	config.step = p.step;
+	config.stiffness = p.stiffness;
+	config.mass = p.mass;
+	config.damping = p.damping;
+	Init();
+}
+
+Scene::Parameters Scene::CurrentParameters() const
+{
+	Parameters p = { config.method, config.step, config.stiffness, config.mass, config.damping };
+	return p;
+}
+
+// Rectangular cloth of xPoints x yPoints mass points spanning xSize x ySize,
+// hanging from its two upper corners. Particles are stored row by row from
+// the top, and every particle is connected to its neighbours by
+//  - structural springs: right and below
+//  - shear springs: both diagonals
+//  - bend springs: second neighbour right and below
+// The z dimension of -size is ignored, the simulation is 2D.
+void Scene::CreateCloth(ParticleSystem &ps, const Config &config)
+{
+	const int nx = config.xPoints, ny = config.yPoints;
+	if (nx < 2 || ny < 2)
+		throw std::invalid_argument("The cloth needs at least 2 x 2 points, got " + std::to_string(nx) + " x " + std::to_string(ny));
+
+	const double dx = config.xSize / (nx - 1);
+	const double dy = config.ySize / (ny - 1);
+	const double top = 1.0;
+	const double left = -0.5 * config.xSize;
+	// structural, shear and bend springs
+	ps.Reserve(nx * ny, (nx - 1) * ny + nx * (ny - 1) + 2 * (nx - 1) * (ny - 1) + (nx - 2) * ny + nx * (ny - 2));
+
+	for (int j = 0; j < ny; j++)
+		for (int i = 0; i < nx; i++)
+		{
+			bool fixed = (j == 0) && (i == 0 || i == nx - 1);
+			ps.AddParticle(left + i * dx, top - j * dy, config.mass, fixed);
+		}
+
+	for (int j = 0; j < ny; j++)
+		for (int i = 0; i < nx; i++)
+		{
+			const int p = j * nx + i;
+			// structural
+			if (i + 1 < nx)
+				ps.AddSpring(p, p + 1, config.stiffness);
+			if (j + 1 < ny)
+				ps.AddSpring(p, p + nx, config.stiffness);
+			// shear
+			if (i + 1 < nx && j + 1 < ny)
+			{
+				ps.AddSpring(p, p + nx + 1, config.stiffness);
+				ps.AddSpring(p + 1, p + nx, config.stiffness);
+			}
+			// bend
+			if (i + 2 < nx)
+				ps.AddSpring(p, p + 2, config.stiffness);
+			if (j + 2 < ny)
+				ps.AddSpring(p, p + 2 * nx, config.stiffness);
+		}
 
+	// contacts must not fire between resting neighbours
+	const double spacing = (dx < dy) ? dx : dy;
+	ps.radius = (config.radius < 0.4 * spacing) ? config.radius : 0.4 * spacing;
+}
+
+void Scene::timeStepReductionLoop(double stiffness, double mass, double damping, double L, double step, int numofIterations)
+{
 	// Start from t = 0.1 with corresponding position/velocity
-	double startT = 0.1;
-	double startPos = -1.0450963438512906;
-	double startV = -0.82548303829779446;
-	
+	const double startPos = -1.0450963438512906;
+	const double startV = -0.82548303829779446;
+
+	std::vector<int> methods;
+	std::vector<double> steps;
+	for (int m = 1; m < METHODS_NUM; m++)
+		methods.push_back(m);
+	double currstep = step;
 	for (int i = 0; i < numofIterations; i++)
 	{
-		printf("%.5lf ", currstep);
-		for (int m = 1; m <= 5; m++)
+		steps.push_back(currstep);
+		currstep /= 2.0;
+	}
+
+	// value[0]: velocity change, value[1]: displacement after one step
+	ThreadPool pool(config.numThreads);
+	std::vector<SweepResult> results = RunSweep(
+		MakeSweepGrid(methods, steps, { stiffness }, { mass }, { damping }),
+		[L, startPos, startV](const SweepPoint &p, SweepResult &r)
 		{
+			// The analytic solution is evaluated at time step after the start state
 			double p2y = startPos, v2y = startV;
-			if (m != ANALYTIC)
-				AdvanceTimeStep1(stiffness, mass, damping, L, currstep, m, 0, 0, p2y, v2y);
-			else
-				AdvanceTimeStep1(stiffness, mass, damping, L, startT + currstep, m, 0, 0, p2y, v2y);
-			printf("%.5e ", v2y - startV);
-		}
+			Spring1State state(startPos, startV);
+			AdvanceTimeStep1(p.stiffness, p.mass, p.damping, L, p.step, p.method, 0, 0, p2y, v2y, state);
+			r.value[0] = v2y - startV;
+			r.value[1] = p2y - startPos;
+		}, pool);
+
+	const char *tables[2] = { "velocity change table:", "displacement table:" };
+	for (int t = 0; t < 2; t++)
+	{
+		cout << tables[t] << endl;
+		cout << "step ";
+		for (size_t m = 0; m < methods.size(); m++)
+			cout << methodNames[methods[m]] << " ";
 		cout << endl;
-		currstep /= 2.0;
+		for (size_t i = 0; i < steps.size(); i++)
+		{
+			printf("%.5lf ", steps[i]);
+			for (size_t m = 0; m < methods.size(); m++)
+				printf("%.5e ", results[i * methods.size() + m].value[t]);
+			cout << endl;
+		}
 	}
-	cout << "displacement table:" << endl;
-	cout << "step ";
-	for (int m = 1; m <= 5; m++)
-		cout << methodNames[m] << " ";
-	currstep = step;
-	cout << endl;
-	for (int i = 0; i < numofIterations; i++)
+}
+
+// Largest deviation |p2 - L| of the hanging mass point released at rest
+// from -L during nSteps steps, compiled once per method
+template<int method>
+struct MaxAmplitudeRun
+{
+	static double Run(double k, double m, double d, double L, double dt, int nSteps)
 	{
-		printf("%.5lf ", currstep);
-		for (int m = 1; m <= 5; m++)
+		double p2 = -L, v2 = 0;
+		double maxAmp = 0;
+		for (int j = 0; j < nSteps; j++)
 		{
-			double p2y = startPos, v2y = startV;
-			if (m != ANALYTIC)
-				AdvanceTimeStep1(stiffness, mass, damping, L, currstep, m, 0, 0, p2y, v2y);
-			else
-				AdvanceTimeStep1(stiffness, mass, damping, L, startT + currstep, m, 0, 0, p2y, v2y);
-			printf("%.5e ", p2y - startPos);
+			Spring1Method<method>::Step(k, m, d, L, dt, 0.0, p2, v2);
+			if (fabs(p2 - L) > maxAmp)
+				maxAmp = fabs(p2 - L);
 		}
-		cout << endl;
-		currstep /= 2.0;
+		return maxAmp;
 	}
-}
+};
+
+// Evaluates the whole time grid in one pass
+template<>
+struct MaxAmplitudeRun<Scene::ANALYTIC>
+{
+	static double Run(double k, double m, double d, double L, double dt, int nSteps)
+	{
+		std::vector<double> t(nSteps), p2(nSteps), v2(nSteps);
+		for (int j = 0; j < nSteps; j++)
+			t[j] = (j + 1) * dt;
+		AnalyticSolution(k, m, d, L, 0.0, -L, 0.0).Evaluate(t.data(), p2.data(), v2.data(), nSteps);
+		double maxAmp = 0;
+		for (int j = 0; j < nSteps; j++)
+			if (fabs(p2[j] - L) > maxAmp)
+				maxAmp = fabs(p2[j] - L);
+		return maxAmp;
+	}
+};
 
 void Scene::stabilityLoop(double stiffness, double mass, double damping, double L, double step, double endTime, int numofIterations)
 {
+	std::vector<int> methods;
+	std::vector<double> steps;
+	for (int m = 1; m < METHODS_NUM; m++)
+		methods.push_back(m);
 	double currstep = step;
-	// damping = 0;
+	for (int i = 0; i < numofIterations; i++)
+	{
+		steps.push_back(currstep);
+		currstep *= 2.0;
+	}
+
+	// value[0]: max amplitude
+	const int numofSteps = (int)(endTime / step);
+	ThreadPool pool(config.numThreads);
+	std::vector<SweepResult> results = RunSweep(
+		MakeSweepGrid(methods, steps, { stiffness }, { mass }, { damping }),
+		[L, numofSteps](const SweepPoint &p, SweepResult &r)
+		{
+			r.value[0] = SelectKernel<MaxAmplitudeRun>(p.method)(p.stiffness, p.mass, p.damping, L, p.step, numofSteps);
+		}, pool);
+
 	cout << "Max amplitude table:" << endl;
 	cout << "step ";
-	for (int m = 1; m <= 5; m++)
-		cout << methodNames[m] << " ";
+	for (size_t m = 0; m < methods.size(); m++)
+		cout << methodNames[methods[m]] << " ";
 	cout << endl;
+	for (size_t i = 0; i < steps.size(); i++)
+	{
+		cout << steps[i] << " ";
+		for (size_t m = 0; m < methods.size(); m++)
+			cout << results[i * methods.size() + m].value[0] << " ";
+		cout << endl;
+	}
+}
+
+// Error at endTime against the analytic solution versus the cost of getting
+// there, for every method and step sizes halving from step. The cost is the
+// fastest of several runs on a single worker, which filters out preemption by
+// the other configurations running in parallel.
+void Scene::workPrecisionLoop(double stiffness, double mass, double damping, double L, double step, double endTime, int numofIterations)
+{
+	std::vector<int> methods;
+	std::vector<double> steps;
+	for (int m = 1; m < METHODS_NUM; m++)
+		methods.push_back(m);
+	double currstep = step;
 	for (int i = 0; i < numofIterations; i++)
 	{
-		int numofSteps = (int)(endTime / step);
-		cout << currstep << " ";
-		for (int m = 1; m <= 5; m++)
+		steps.push_back(currstep);
+		currstep /= 2.0;
+	}
+
+	// hanging at rest length at t = 0, as in the spring1d testcase
+	const double p1 = 0.0, startPos = -1.0, startV = 0.0;
+	double exactPos, exactV;
+	AnalyticSolution(stiffness, mass, damping, L, p1, startPos, startV).Evaluate(endTime, exactPos, exactV);
+
+	// value[0]: position error, value[1]: velocity error, value[2]: seconds
+	// per run, value[3]: number of steps. The adaptive method picks its own
+	// steps, its rows tighten the tolerances to rtol = atol = step^2 instead.
+	ThreadPool pool(config.numThreads);
+	std::vector<SweepResult> results = RunSweep(
+		MakeSweepGrid(methods, steps, { stiffness }, { mass }, { damping }),
+		[L, p1, startPos, startV, endTime, exactPos, exactV](const SweepPoint &p, SweepResult &r)
 		{
-			double p2y = -L, v2y = 0;
-			double maxAmp = 0;
-			for (int j = 0; j < numofSteps; j++)
+			// steps that end exactly at endTime
+			const int nSteps = std::max(1, (int)floor(endTime / p.step + 0.5));
+			const double dt = endTime / nSteps;
+			Spring1Kernel kernel = SelectKernel<Spring1Run>(p.method);
+
+			double p2, v2;
+			long taken = nSteps;
+			double fastest = 0.0, total = 0.0;
+			for (int run = 0; run < 3 || total < 5e-3; run++)
 			{
-				AdvanceTimeStep1(stiffness, mass, damping, L, currstep, m, 0, 0, p2y, v2y);
-				if (fabs(p2y - L) > maxAmp)
-					maxAmp = fabs(p2y - L);
+				auto start = std::chrono::steady_clock::now();
+				p2 = startPos; v2 = startV;
+				Spring1State state(startPos, startV);
+				state.rtol = state.atol = p.step * p.step;
+				kernel(p.stiffness, p.mass, p.damping, L, dt, p1, p2, v2, nSteps, state);
+				if (p.method == ADAPTIVE_RK23)
+					taken = state.accepted + state.rejected;
+				std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+				fastest = (run == 0) ? elapsed.count() : std::min(fastest, elapsed.count());
+				total += elapsed.count();
 			}
-			cout << maxAmp << " ";
+
+			r.value[0] = fabs(p2 - exactPos);
+			r.value[1] = fabs(v2 - exactV);
+			r.value[2] = fastest;
+			r.value[3] = (double)taken;
+		}, pool);
+
+	cout << "Work-precision table (error at t = " << endTime << "):" << endl;
+	cout << "method step steps seconds position_error velocity_error" << endl;
+	for (size_t m = 0; m < methods.size(); m++)
+		for (size_t i = 0; i < steps.size(); i++)
+		{
+			const SweepResult &r = results[i * methods.size() + m];
+			printf("%s %.5e %d %.5e %.5e %.5e\n", methodNames[methods[m]], steps[i], (int)r.value[3],
+				r.value[2], r.value[0], r.value[1]);
 		}
-		cout << endl;
-		currstep *= 2.0;
+
+	// Convergence order: least-squares slope of log(error) over log(step),
+	// using the errors between round-off and the pre-asymptotic range.
+	// Cost: cheapest configuration whose error is within the tolerance. The
+	// analytic solution is the reference and does not compete.
+	cout << endl << "Convergence order and cost at tolerance " << config.tolerance << ":" << endl;
+	cout << "method order seconds step" << endl;
+	int best = -1;
+	double bestSeconds = 0.0;
+	for (size_t m = 0; m < methods.size(); m++)
+	{
+		double sx = 0, sy = 0, sxx = 0, sxy = 0;
+		int n = 0;
+		int cheapest = -1;
+		for (size_t i = 0; i < steps.size(); i++)
+		{
+			const SweepResult &r = results[i * methods.size() + m];
+			const double error = std::max(r.value[0], r.value[1]);
+			if (error > 1e-9 && error < 1e-1)
+			{
+				const double lx = log(steps[i]), ly = log(error);
+				sx += lx; sy += ly; sxx += lx * lx; sxy += lx * ly;
+				n++;
+			}
+			if (error <= config.tolerance && (cheapest < 0 || r.value[2] < results[cheapest * methods.size() + m].value[2]))
+				cheapest = (int)i;
+		}
+
+		cout << methodNames[methods[m]] << " ";
+		if (n >= 2 && n * sxx - sx * sx > 0)
+			printf("%.2f ", (n * sxy - sx * sy) / (n * sxx - sx * sx));
+		else
+			cout << "n/a ";
+		if (cheapest >= 0)
+		{
+			const double seconds = results[cheapest * methods.size() + m].value[2];
+			printf("%.5e %.5e\n", seconds, steps[cheapest]);
+			if (methods[m] != ANALYTIC && (best < 0 || seconds < bestSeconds))
+			{
+				best = methods[m];
+				bestSeconds = seconds;
+			}
+		}
+		else
+			cout << "n/a n/a" << endl;
 	}
+	if (best >= 0)
+		cout << "Cheapest method at tolerance " << config.tolerance << ": " << methodNames[best] << endl;
+	else
+		cout << "No method reaches tolerance " << config.tolerance << endl;
 }
 
 void Scene::Update(void)
@@ -312,46 +714,131 @@ void Scene::Update(void)
 	{
 		return;
 	}
-	static double curr_time = 0;
-	curr_time += step;
+	PROFILE_SCOPE("Update");
+	time += config.step;
 	// damping = 0;
 	int numofIterations = 10;
 	double endTime = 10;
 	// Perform animation
-	switch (testcase) {
+	double L = particles.restLength[0];
+	switch (config.testcase) {
 	case SPRING1D:
-		if (method == ANALYTIC)
-			AdvanceTimeStep1(stiffness, mass, damping, L, curr_time, method, p1.y(), v1.y(), p2.y(), v2.y());
-		else
-			AdvanceTimeStep1(stiffness, mass, damping, L, step, method, p1.y(), v1.y(), p2.y(), v2.y());
+		// kernel for the method selected in Init
+		{
+			PROFILE_SCOPE("Integrate");
+			spring1Kernel(config.stiffness, config.mass, config.damping, L, config.step, particles.y[0], particles.y[1], particles.vy[1], 1, spring1);
+		}
 		break;
 	case FALLING:
-		AdvanceTimeStep3(stiffness, mass, damping, L, step, p1, v1, p2, v2, p3, v3);
+	case CLOTH:
+		if (config.method == IMPLICIT_EULER)
+			implicitSolver.Step(particles, config.damping, config.step);
+		else if (config.method == ADAPTIVE_RK23)
+			adaptiveSolver.Advance(particles, config.damping, config.step);
+		else if (config.method == XPBD)
+			xpbdSolver.Step(particles, config.damping, config.step);
+		else if (config.method == PROJECTIVE_DYNAMICS)
+			projectiveSolver.Step(particles, config.damping, config.step);
+		else if (config.method == BACK_EULER)
+			AdvanceTimeStep3(config.damping, config.step, particles);
+		else
+			explicitSolver.Step(particles, config.method, config.damping, config.step);
+		WriteOutput(time);
 		break;
 	case ERROR_MEASUREMENT:
-		timeStepReductionLoop(stiffness, mass, damping, L, step, numofIterations);
-		exit(0);
+		timeStepReductionLoop(config.stiffness, config.mass, config.damping, L, config.step, numofIterations);
+		finished = true;
+		pause = true;
 		break;
 	case STABILITY_MEASUREMENT:
-		stabilityLoop(stiffness, mass, damping, L, step, endTime, numofIterations);
-		exit(0);
+		stabilityLoop(config.stiffness, config.mass, config.damping, L, config.step, endTime, numofIterations);
+		finished = true;
+		pause = true;
+		break;
+	case WORK_PRECISION:
+		workPrecisionLoop(config.stiffness, config.mass, config.damping, L, config.step, endTime, numofIterations);
+		finished = true;
+		pause = true;
+		break;
+	case INVALID_TESTCASE:
+		// refused by ParseArguments, nothing to advance
 		break;
 	}
-	points[0].pos = p1;
-	points[1].pos = p2;
-	if (nPoints > 2)
+	if (!config.headless)
+		Publish();
+}
+
+// Hand the current positions to the renderer
+void Scene::Publish()
+{
+	RenderState &state = view.Write();
+	state.x.assign(particles.x.begin(), particles.x.end());
+	state.y.assign(particles.y.begin(), particles.y.end());
+	view.Publish();
+}
+
+void Scene::OpenOutput()
+{
+	CloseOutput();
+	if (config.outFile.empty() || IsMeasurement(config.testcase))
+		return;
+
+	// The 1D spring records (p2, v2) from inside AdvanceTimeStep1, all other
+	// testcases (x, y, vx, vy) of every particle
+	TrajectoryHeader header;
+	header.valueSize = config.outDouble ? 8 : 4;
+	header.channels = (config.testcase == SPRING1D) ? 2 : 4 * nPoints;
+	header.stride = config.outStride;
+	header.method = config.method;
+	header.testcase = config.testcase;
+	header.stiffness = config.stiffness;
+	header.mass = config.mass;
+	header.damping = config.damping;
+	header.step = config.step;
+	if (!output.Open(config.outFile.c_str(), header))
+		throw std::runtime_error("Cannot open output file " + config.outFile);
+
+	if (config.testcase == SPRING1D)
 	{
-		points[2].pos = p3;
+		const double values[2] = { particles.y[1], particles.vy[1] };
+		output.Write(0.0, values);
+		spring1.output = &output;
 	}
+	else
+		WriteOutput(0.0);
 }
 
-void Scene::Render(void)
+bool Scene::CloseOutput(void)
 {
-	for (int i = 0; i < nSprings; i++)
-		springs[i].render();
+	if (output.Close())
+		return true;
+	cerr << "Cannot write output file " << config.outFile << ", the trajectory is incomplete" << endl;
+	return false;
+}
 
+void Scene::WriteOutput(double t)
+{
+	if (!output.IsOpen())
+		return;
+	PROFILE_SCOPE("Output");
+	outValues.resize(4 * nPoints);
 	for (int i = 0; i < nPoints; i++)
-		points[i].render();
+	{
+		outValues[4 * i + 0] = particles.x[i];
+		outValues[4 * i + 1] = particles.y[i];
+		outValues[4 * i + 2] = particles.vx[i];
+		outValues[4 * i + 3] = particles.vy[i];
+	}
+	output.Write(t, outValues.data());
+}
+
+void Scene::Render(void)
+{
+	PROFILE_SCOPE("Render");
+	view.Update();
+	const RenderState &state = view.Read();
+	batch.Update(state.x.data(), state.y.data(), (int)state.x.size());
+	batch.Render();
 
 	// Draw Ground Floor:
 	glColor3f(0.0f, 1.0f, 0.0f);
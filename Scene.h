@@ -5,63 +5,189 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <string>
 #include <vector>
 #include "Primitives.h"
+#include "ParticleSystem.h"
+#include "Exercise.h"
+#include "ImplicitSolver.h"
+#include "AdaptiveSolver.h"
+#include "ExplicitSolver.h"
+#include "XPBDSolver.h"
+#include "ProjectiveSolver.h"
+#include "ThreadPool.h"
 #include "Utilities/Vector2T.h"
+#include "Utilities/TripleBuffer.h"
+
+// Particle positions handed from the simulation thread to the renderer
+struct RenderState
+{
+	std::vector<double> x, y;
+};
+
+// Command line names of Scene::Method, indexed by the enum value
+#define METHODS_NUM 12
+extern const char *methodNames[METHODS_NUM];
+// Command line names of Scene::Testcase, indexed by the enum value
+#define TESTCASES_NUM 7
+extern const char *testcaseNames[TESTCASES_NUM];
 
 class Scene
 {
 
 public:
-	// General statics
-	static int xPoints;
-	static int yPoints;
-	static int zPoints;
-	static double xSize;
-	static double ySize;
-	static double zSize;
-
-	static double step;
-	static double mass;
-	static double stiffness;
-	static double damping;
-	double L;
-	Vec2 p1, p2, p3;
-	Vec2 v1, v2, v3;
-
-	enum Method { INVALID_METHOD = 0, EULER = 1, LEAP_FROG = 2, MIDPOINT = 3, BACK_EULER = 4, ANALYTIC = 5 };
-	static Method method;
-	enum Testcase { INVALID_TESTCASE = 0, SPRING1D = 1, FALLING = 2, ERROR_MEASUREMENT = 3, STABILITY_MEASUREMENT = 4 };
-	static Testcase testcase;
+	enum Method { INVALID_METHOD = 0, EULER = 1, LEAP_FROG = 2, MIDPOINT = 3, BACK_EULER = 4, ANALYTIC = 5, IMPLICIT_EULER = 6, ADAPTIVE_RK23 = 7, RK4 = 8, VELOCITY_VERLET = 9, XPBD = 10, PROJECTIVE_DYNAMICS = 11 };
+	enum Testcase { INVALID_TESTCASE = 0, SPRING1D = 1, FALLING = 2, ERROR_MEASUREMENT = 3, STABILITY_MEASUREMENT = 4, CLOTH = 5, WORK_PRECISION = 6 };
+
+	// Settings of one scene. Every scene owns a copy, so one process can run
+	// many scenes with different settings side by side.
+	struct Config
+	{
+		Testcase testcase;
+		Method method;
+
+		// Grid points and extent of the cloth
+		int xPoints, yPoints, zPoints;
+		double xSize, ySize, zSize;
+
+		double step;
+		double mass;
+		double stiffness;
+		double damping;
+
+		// Headless batch mode
+		bool headless;
+		int numSteps;
+
+		// Binary trajectory output, none if empty
+		std::string outFile;
+		int outStride;
+		bool outDouble;
+
+		// Contact radius of the particles, 0 disables particle-particle
+		// contacts
+		double radius;
+
+		// Worker threads for parameter sweeps and large spring networks, 0
+		// uses all cores, 1 keeps the scene on the calling thread
+		int numThreads;
+
+		// Chrome trace of the profiled stages, written at exit when built
+		// with ENABLE_PROFILING, none if empty
+		std::string traceFile;
+
+		// Error tolerances of the adaptive method
+		double rtol;
+		double atol;
+
+		// Constraint sweeps per step of the XPBD method, local/global
+		// iterations of projective dynamics
+		int solverIterations;
+
+		// Target error of the work-precision testcase
+		double tolerance;
+
+		// Comma-separated methods to run side by side in one process, see
+		// SceneBatch; empty runs the single scene
+		std::string batch;
+
+		Config(void);
+	};
+
+	// Settings that may change between runs of the same scene
+	struct Parameters
+	{
+		Method method;
+		double step;
+		double stiffness;
+		double mass;
+		double damping;
+	};
+
+	// Reads the command line options into a config, prints the usage and
+	// exits on unknown options
+	static Config ParseArguments(int argc, char* argv[]);
+	// Testcases that print tables instead of animating
+	static bool IsMeasurement(Testcase testcase);
+	// Whether the testcase has an integrator for the method. The spring
+	// networks have no analytic solution; measurements run all methods.
+	static bool Supports(Testcase testcase, Method method);
+	// Adds the cloth of the config to ps, see the CLOTH testcase. Throws
+	// std::invalid_argument for fewer than 2 x 2 points.
+	static void CreateCloth(ParticleSystem &ps, const Config &config);
+
+	Config config;
 
 protected:
 	// methods
+	void OpenOutput();
+	void WriteOutput(double t);
+	void Publish();
 	void timeStepReductionLoop(double stiffness, double mass, double damping, double L, double step, int numofIterations);
 	void stabilityLoop(double stiffness, double mass, double damping, double L, double step, double endTime, int numofIterations);
+	void workPrecisionLoop(double stiffness, double mass, double damping, double L, double step, double endTime, int numofIterations);
 
 	//Data members
-	std::vector<MPoint> points;
-	std::vector<MSpring> springs;
+	ParticleSystem particles;
+	// particles as the last Init built them, reused by a Reset to the same
+	// network
+	ParticleSystem network;
+	Spring1State spring1;
+	Spring1Kernel spring1Kernel;
+	ImplicitEulerSolver implicitSolver;
+	AdaptiveRKSolver adaptiveSolver;
+	ExplicitSolver explicitSolver;
+	XPBDSolver xpbdSolver;
+	ProjectiveDynamicsSolver projectiveSolver;
+	TrajectoryWriter output;
+	std::unique_ptr<ThreadPool> workers;
+	std::vector<double> outValues;
+	PrimitiveBatch batch;
+	TripleBuffer<RenderState> view;
 
 	//Data size
 	int nSprings;
 	int nPoints;
 
 	//Animation
+	double time;	// simulated time of the current run
 	bool pause;
-
-	//Animation state
-	double *x0, *x;
-	double *v0, *v;
+	std::atomic<bool> finished;
 
 public:
 	Scene(void);
 	Scene(int argc, char* argv[]);
+	// Throws std::invalid_argument if the config describes no valid scene,
+	// std::runtime_error if its output file cannot be created
+	explicit Scene(const Config &_config);
 	~Scene(void);
 
 	//Initialization
 	void Init(void);
+	// Back to the initial state of the testcase for another run. Particle
+	// arrays and solver buffers keep their capacity, and a network rebuilt
+	// with the same masses and springs keeps its spring colors and version,
+	// so the solvers keep their matrices and a rerun allocates nothing. The
+	// run repeats the previous one bitwise. config.outFile is reopened and
+	// truncated, point it elsewhere first to keep the previous trajectory.
+	// selfcheck reset verifies all of this.
+	void Reset(void);
+	// Reset with other parameters, e.g. the next point of a sweep
+	void Reset(const Parameters &p);
+	Parameters CurrentParameters() const;
 	void PrintSettings(void);
+	// Accepted and rejected steps of the adaptive method
+	void PrintStatistics(void);
+	// Writes the rest of the trajectory; prints an error and returns false
+	// if the output file is incomplete
+	bool CloseOutput(void);
+	// Render() may run on another thread than Update(), it draws the state
+	// last published by Update()
 	void Render();
 	void Update();
+
+	// True once a measurement testcase has produced its tables
+	bool Finished() const { return finished; }
 };
@@ -0,0 +1,42 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "SceneBatch.h"
+#include <algorithm>
+
+int SceneBatch::Add(const Scene::Config &config)
+{
+	Scene::Config c = config;
+	c.headless = true;
+	c.numThreads = 1;
+	scenes.push_back(std::unique_ptr<Scene>(new Scene(c)));
+	return Count() - 1;
+}
+
+void SceneBatch::Step(int nSteps)
+{
+	// a few chunks per thread, so uneven scene sizes still balance
+	const int n = Count();
+	const int grain = std::max(1, n / (4 * std::max(1, pool.ThreadCount())));
+	pool.ParallelFor(0, n, grain, [this, nSteps](int first, int last)
+	{
+		for (int i = first; i < last; i++)
+		{
+			Scene &scene = *scenes[i];
+			for (int s = 0; s < nSteps && !scene.Finished(); s++)
+				scene.Update();
+		}
+	});
+}
+
+void SceneBatch::Reset()
+{
+	const int n = Count();
+	pool.ParallelFor(0, n, 1, [this](int first, int last)
+	{
+		for (int i = first; i < last; i++)
+			scenes[i]->Reset();
+	});
+}
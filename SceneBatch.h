@@ -0,0 +1,38 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Scene.h"
+#include "ThreadPool.h"
+
+// Independent scenes stepped together on one thread pool, e.g. the same
+// testcase for many methods or parameters. Every scene has its own config,
+// clock and buffers; the scenes are spread over the pool, and each one runs
+// on a single thread, so a batch of small scenes keeps all cores busy
+// without spawning a process per configuration.
+class SceneBatch
+{
+public:
+	explicit SceneBatch(ThreadPool &_pool) : pool(_pool) {}
+
+	// Builds a headless scene for the config and returns its index. The
+	// scene uses no workers of its own.
+	int Add(const Scene::Config &config);
+	int Count() const { return (int)scenes.size(); }
+	Scene &operator[](int i) { return *scenes[i]; }
+
+	// Advances every scene by nSteps steps, scenes that finish early stop
+	// there. Returns once all scenes are done.
+	void Step(int nSteps);
+	// Rewinds every scene to its initial state
+	void Reset();
+
+private:
+	ThreadPool &pool;
+	std::vector<std::unique_ptr<Scene> > scenes;
+};
@@ -0,0 +1,86 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "SimulationThread.h"
+#include "Scene.h"
+
+StepScheduler::StepScheduler(Clock::duration _step, int _maxSubsteps)
+	: step(_step), maxSubsteps(_maxSubsteps), accumulator(0)
+{
+	if (step <= Clock::duration::zero())
+		step = Clock::duration(1);
+	if (maxSubsteps < 1)
+		maxSubsteps = 1;
+}
+
+void StepScheduler::Start(Clock::time_point now)
+{
+	accumulator = Clock::duration(0);
+	last = now;
+}
+
+int StepScheduler::Advance(Clock::time_point now)
+{
+	accumulator += now - last;
+	last = now;
+
+	int due = 0;
+	while (accumulator >= step && due < maxSubsteps)
+	{
+		accumulator -= step;
+		due++;
+	}
+	// Drop the backlog we cannot catch up with
+	if (accumulator >= step)
+		accumulator = step;
+	return due;
+}
+
+StepScheduler::Clock::duration StepScheduler::UntilNextStep() const
+{
+	return (accumulator >= step) ? Clock::duration(0) : step - accumulator;
+}
+
+StepScheduler::Clock::time_point StepScheduler::NextDeadline(Clock::time_point deadline, Clock::duration period, Clock::time_point now)
+{
+	deadline += period;
+	if (deadline < now)
+		deadline = now + period;
+	return deadline;
+}
+
+void SimulationThread::Start(Scene &scene, int maxSubsteps)
+{
+	Stop();
+	steps = 0;
+	running = true;
+	thread = std::thread(&SimulationThread::Run, this, &scene, maxSubsteps);
+}
+
+void SimulationThread::Stop()
+{
+	running = false;
+	if (thread.joinable())
+		thread.join();
+}
+
+void SimulationThread::Run(Scene *scene, int maxSubsteps)
+{
+	typedef StepScheduler::Clock Clock;
+	StepScheduler scheduler(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(scene->config.step)), maxSubsteps);
+	scheduler.Start(Clock::now());
+	while (running && !scene->Finished())
+	{
+		const int due = scheduler.Advance(Clock::now());
+		for (int i = 0; i < due && running; i++)
+		{
+			scene->Update();
+			steps++;
+		}
+		const Clock::duration wait = scheduler.UntilNextStep();
+		if (wait > Clock::duration::zero())
+			std::this_thread::sleep_for(wait);
+	}
+}
@@ -0,0 +1,69 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+class Scene;
+
+// Fixed-step schedule of a simulation against wall-clock time. Every step
+// covers step of elapsed time, the accumulator holds the time not simulated
+// yet. The times come from the caller, so the schedule can be driven by a
+// fake clock.
+class StepScheduler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// step <= 0 is raised to one clock tick
+	StepScheduler(Clock::duration step, int maxSubsteps);
+
+	void Start(Clock::time_point now);
+	// Steps due at now, at most maxSubsteps; a simulation slower than real
+	// time falls behind, the backlog beyond one step is dropped instead of
+	// piling up work
+	int Advance(Clock::time_point now);
+	// Time until the next step is due, zero if one is due already
+	Clock::duration UntilNextStep() const;
+
+	Clock::duration Step() const { return step; }
+
+	// First deadline of a periodic timer after now: the next period after
+	// deadline, or one period from now if the timer fell behind
+	static Clock::time_point NextDeadline(Clock::time_point deadline, Clock::duration period, Clock::time_point now);
+
+private:
+	Clock::duration step;
+	int maxSubsteps;
+	Clock::duration accumulator;
+	Clock::time_point last;
+};
+
+// Advances a scene on its own thread in real time, so slow frames do not
+// stall the physics and slow steps do not stall the window. The scene hands
+// its state to the renderer through Scene::Render.
+class SimulationThread
+{
+public:
+	SimulationThread(void) : running(false), steps(0) {}
+	~SimulationThread(void) { Stop(); }
+
+	void Start(Scene &scene, int maxSubsteps);
+	// Finishes the current step and joins the thread; does nothing if it
+	// is not running
+	void Stop();
+	// Steps taken since Start
+	long Steps() const { return steps; }
+
+private:
+	void Run(Scene *scene, int maxSubsteps);
+
+	std::thread thread;
+	std::atomic<bool> running;
+	std::atomic<long> steps;
+};
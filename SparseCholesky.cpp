@@ -0,0 +1,237 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "SparseCholesky.h"
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <utility>
+
+void SparseCholesky::MinimumDegreeOrder(int n, const std::vector<int> &colStart, const std::vector<int> &rows, std::vector<int> &order)
+{
+	// explicit elimination graph, every adjacency list sorted and without
+	// the node itself
+	std::vector<std::vector<int>> adj(n);
+	for (int j = 0; j < n; j++)
+	{
+		for (int p = colStart[j]; p < colStart[j + 1]; p++)
+			if (rows[p] != j)
+				adj[j].push_back(rows[p]);
+		std::sort(adj[j].begin(), adj[j].end());
+		adj[j].erase(std::unique(adj[j].begin(), adj[j].end()), adj[j].end());
+	}
+
+	// smallest degree first, ties by index; entries whose degree changed
+	// since they were queued are skipped
+	typedef std::pair<int, int> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+	for (int j = 0; j < n; j++)
+		queue.push(Entry((int)adj[j].size(), j));
+
+	std::vector<char> eliminated(n, 0);
+	std::vector<int> merged;
+	order.clear();
+	order.reserve(n);
+	while (!queue.empty())
+	{
+		const Entry top = queue.top();
+		queue.pop();
+		const int v = top.second;
+		if (eliminated[v] || top.first != (int)adj[v].size())
+			continue;
+		eliminated[v] = 1;
+		order.push_back(v);
+
+		// the neighbours of v become a clique
+		const std::vector<int> &clique = adj[v];
+		bool massElimination = false;
+		for (size_t c = 0; c < clique.size(); c++)
+		{
+			std::vector<int> &list = adj[clique[c]];
+			merged.clear();
+			std::set_union(list.begin(), list.end(), clique.begin(), clique.end(), std::back_inserter(merged));
+			list.clear();
+			for (size_t m = 0; m < merged.size(); m++)
+				if (merged[m] != v && merged[m] != clique[c])
+					list.push_back(merged[m]);
+			// adjacent to the clique only: next in line and without fill
+			if (list.size() + 1 == clique.size())
+			{
+				eliminated[clique[c]] = 1;
+				massElimination = true;
+			}
+		}
+		// eliminate those right away, the others lose them as neighbours
+		for (size_t c = 0; c < clique.size(); c++)
+		{
+			const int u = clique[c];
+			std::vector<int> &list = adj[u];
+			if (eliminated[u])
+			{
+				order.push_back(u);
+				std::vector<int>().swap(list);
+				continue;
+			}
+			if (massElimination)
+				list.erase(std::remove_if(list.begin(), list.end(), [&eliminated](int w) { return eliminated[w] != 0; }), list.end());
+			queue.push(Entry((int)list.size(), u));
+		}
+		std::vector<int>().swap(adj[v]);
+	}
+}
+
+bool SparseCholesky::Factor(int _n, const std::vector<int> &colStart, const std::vector<int> &rows, const std::vector<double> &values)
+{
+	n = _n;
+	MinimumDegreeOrder(n, colStart, rows, perm);
+	permInv.resize(n);
+	for (int k = 0; k < n; k++)
+		permInv[perm[k]] = k;
+
+	// symbolic: elimination tree and column counts of the permuted matrix
+	std::vector<int> parent(n), flag(n), count(n);
+	for (int k = 0; k < n; k++)
+	{
+		parent[k] = -1;
+		flag[k] = k;
+		count[k] = 0;
+		const int kk = perm[k];
+		for (int p = colStart[kk]; p < colStart[kk + 1]; p++)
+		{
+			// follow the path from i to the root of its subtree, marking
+			// every column that gains an entry in row k
+			for (int i = permInv[rows[p]]; i < k && flag[i] != k; i = parent[i])
+			{
+				if (parent[i] == -1)
+					parent[i] = k;
+				count[i]++;
+				flag[i] = k;
+			}
+		}
+	}
+	Lp.resize(n + 1);
+	Lp[0] = 0;
+	for (int k = 0; k < n; k++)
+		Lp[k + 1] = Lp[k] + count[k];
+	Li.resize(Lp[n]);
+	Lx.resize(Lp[n]);
+	D.resize(n);
+	work.assign(2 * n, 0.0);
+
+	// numeric: row k of L solves L(0:k-1, 0:k-1) D l = A(0:k-1, k), its
+	// pattern is the union of the etree paths of the entries of column k
+	std::vector<double> &y = work;
+	std::vector<int> pattern(n);
+	for (int k = 0; k < n; k++)
+	{
+		y[k] = 0.0;
+		int top = n;
+		flag[k] = k;
+		count[k] = 0;
+		const int kk = perm[k];
+		for (int p = colStart[kk]; p < colStart[kk + 1]; p++)
+		{
+			int i = permInv[rows[p]];
+			if (i > k)
+				continue;
+			y[i] += values[p];
+			int len = 0;
+			for (; flag[i] != k; i = parent[i])
+			{
+				pattern[len++] = i;
+				flag[i] = k;
+			}
+			while (len > 0)
+				pattern[--top] = pattern[--len];
+		}
+
+		D[k] = y[k];
+		y[k] = 0.0;
+		for (; top < n; top++)
+		{
+			const int i = pattern[top];
+			const double yi = y[i];
+			y[i] = 0.0;
+			int p = Lp[i];
+			for (const int end = Lp[i] + count[i]; p < end; p++)
+				y[Li[p]] -= Lx[p] * yi;
+			const double lki = yi / D[i];
+			D[k] -= lki * yi;
+			Li[p] = k;
+			Lx[p] = lki;
+			count[i]++;
+		}
+		if (!(D[k] > 0.0))
+		{
+			n = 0;
+			return false;
+		}
+	}
+	return true;
+}
+
+void SparseCholesky::Solve(double *b) const
+{
+	std::vector<double> &x = work;
+	for (int k = 0; k < n; k++)
+		x[k] = b[perm[k]];
+
+	// L z = x, then D L^T x = z
+	for (int j = 0; j < n; j++)
+	{
+		const double xj = x[j];
+		for (int p = Lp[j]; p < Lp[j + 1]; p++)
+			x[Li[p]] -= Lx[p] * xj;
+	}
+	for (int j = n - 1; j >= 0; j--)
+	{
+		double xj = x[j] / D[j];
+		for (int p = Lp[j]; p < Lp[j + 1]; p++)
+			xj -= Lx[p] * x[Li[p]];
+		x[j] = xj;
+	}
+
+	for (int k = 0; k < n; k++)
+		b[perm[k]] = x[k];
+}
+
+void SparseCholesky::Solve(double *b0, double *b1) const
+{
+	// interleaved, so both columns share every load of L
+	std::vector<double> &x = work;
+	for (int k = 0; k < n; k++)
+	{
+		x[2 * k] = b0[perm[k]];
+		x[2 * k + 1] = b1[perm[k]];
+	}
+
+	for (int j = 0; j < n; j++)
+	{
+		const double x0 = x[2 * j], x1 = x[2 * j + 1];
+		for (int p = Lp[j]; p < Lp[j + 1]; p++)
+		{
+			x[2 * Li[p]] -= Lx[p] * x0;
+			x[2 * Li[p] + 1] -= Lx[p] * x1;
+		}
+	}
+	for (int j = n - 1; j >= 0; j--)
+	{
+		double x0 = x[2 * j] / D[j], x1 = x[2 * j + 1] / D[j];
+		for (int p = Lp[j]; p < Lp[j + 1]; p++)
+		{
+			x0 -= Lx[p] * x[2 * Li[p]];
+			x1 -= Lx[p] * x[2 * Li[p] + 1];
+		}
+		x[2 * j] = x0;
+		x[2 * j + 1] = x1;
+	}
+
+	for (int k = 0; k < n; k++)
+	{
+		b0[perm[k]] = x[2 * k];
+		b1[perm[k]] = x[2 * k + 1];
+	}
+}
@@ -0,0 +1,47 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <vector>
+
+// Sparse LDL^T factorization of a symmetric positive definite matrix for
+// repeated solves with the same matrix. The rows and columns are reordered by
+// minimum degree first to keep the fill-in of L small. The factorization
+// follows the up-looking algorithm of Davis' LDL package: the elimination
+// tree gives the pattern of L, every row of L is then one sparse triangular
+// solve.
+class SparseCholesky
+{
+public:
+	SparseCholesky(void) : n(0) {}
+
+	// Factors the n x n matrix given in compressed columns with both
+	// triangles stored: the rows of column j are rows[colStart[j] ...
+	// colStart[j + 1] - 1]. Returns false if the matrix is not positive
+	// definite.
+	bool Factor(int n, const std::vector<int> &colStart, const std::vector<int> &rows, const std::vector<double> &values);
+
+	// Overwrites b with the solution of A x = b
+	void Solve(double *b) const;
+	// Two right-hand sides in one pass over L
+	void Solve(double *b0, double *b1) const;
+
+	int Size() const { return n; }
+	// Nonzeros below the diagonal of L
+	int FactorNonzeros() const { return n ? Lp[n] : 0; }
+
+	// Minimum degree elimination order of the symmetric pattern: order[k] is
+	// the k-th row to eliminate
+	static void MinimumDegreeOrder(int n, const std::vector<int> &colStart, const std::vector<int> &rows, std::vector<int> &order);
+
+private:
+	int n;
+	std::vector<int> perm, permInv;
+	// strictly lower triangle of L by columns, and D
+	std::vector<int> Lp, Li;
+	std::vector<double> Lx, D;
+	mutable std::vector<double> work;
+};
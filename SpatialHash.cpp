@@ -0,0 +1,56 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "SpatialHash.h"
+#include <math.h>
+
+void SpatialHash::Build(const double *x, const double *y, int n, double _cellSize)
+{
+	cellSize = _cellSize;
+
+	// power of two with about two buckets per particle
+	unsigned buckets = 1;
+	while (buckets < 2u * (unsigned)n)
+		buckets <<= 1;
+	mask = buckets - 1;
+
+	cellX.resize(n);
+	cellY.resize(n);
+	sortedIndex.resize(n);
+	sortedX.resize(n);
+	sortedY.resize(n);
+	sortedCellX.resize(n);
+	sortedCellY.resize(n);
+	bucketStart.assign(buckets + 1, 0);
+
+	// count particles per bucket
+	const double inv = 1.0 / cellSize;
+	for (int i = 0; i < n; i++)
+	{
+		cellX[i] = (int)floor(x[i] * inv);
+		cellY[i] = (int)floor(y[i] * inv);
+		bucketStart[Bucket(cellX[i], cellY[i]) + 1]++;
+	}
+
+	// prefix sum gives the first slot of every bucket
+	for (unsigned b = 0; b < buckets; b++)
+		bucketStart[b + 1] += bucketStart[b];
+
+	// scatter, bucketStart[b] is the insertion cursor of bucket b and ends
+	// up at the end of the bucket
+	for (int i = 0; i < n; i++)
+	{
+		int slot = bucketStart[Bucket(cellX[i], cellY[i])]++;
+		sortedIndex[slot] = i;
+		sortedX[slot] = x[i];
+		sortedY[slot] = y[i];
+		sortedCellX[slot] = cellX[i];
+		sortedCellY[slot] = cellY[i];
+	}
+	// undo the cursor shift
+	for (unsigned b = buckets; b > 0; b--)
+		bucketStart[b] = bucketStart[b - 1];
+	bucketStart[0] = 0;
+}
@@ -0,0 +1,81 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <vector>
+
+// Uniform grid hashed into a fixed number of buckets. Build() counting-sorts
+// the particles by bucket, so that all particles of a bucket lie contiguously
+// in sortedIndex/sortedX/sortedY. Both building and querying are O(n) for
+// particles that are not packed much denser than one per cell.
+class SpatialHash
+{
+public:
+	SpatialHash(void) : cellSize(1.0), mask(0) {}
+
+	// Sort the n points into cells of the given size
+	void Build(const double *x, const double *y, int n, double cellSize);
+
+	// Calls visit(i, j, dx, dy, dist2) once for every pair i != j closer than
+	// maxDist, with (dx, dy) = p_j - p_i. maxDist must not exceed the cell size.
+	template<class Visitor>
+	void ForEachPair(double maxDist, Visitor visit) const;
+
+private:
+	int Bucket(int cx, int cy) const
+	{
+		unsigned h = (unsigned)cx * 73856093u ^ (unsigned)cy * 19349663u;
+		return (int)(h & mask);
+	}
+
+	double cellSize;
+	unsigned mask;
+	std::vector<int> cellX, cellY;		// cell of every particle
+	std::vector<int> bucketStart;		// size buckets + 1
+	// particle indices, positions and cells ordered by bucket
+	std::vector<int> sortedIndex;
+	std::vector<double> sortedX, sortedY;
+	std::vector<int> sortedCellX, sortedCellY;
+};
+
+template<class Visitor>
+void SpatialHash::ForEachPair(double maxDist, Visitor visit) const
+{
+	const double maxDist2 = maxDist * maxDist;
+	const int n = (int)sortedIndex.size();
+	for (int s = 0; s < n; s++)
+	{
+		const int i = sortedIndex[s];
+		const double xi = sortedX[s], yi = sortedY[s];
+
+		// the 3x3 neighbourhood, skipping buckets that two cells share
+		int visited[9];
+		int nVisited = 0;
+		for (int oy = -1; oy <= 1; oy++)
+			for (int ox = -1; ox <= 1; ox++)
+			{
+				const int bucket = Bucket(sortedCellX[s] + ox, sortedCellY[s] + oy);
+				bool seen = false;
+				for (int v = 0; v < nVisited; v++)
+					seen = seen || visited[v] == bucket;
+				if (seen)
+					continue;
+				visited[nVisited++] = bucket;
+
+				for (int t = bucketStart[bucket]; t < bucketStart[bucket + 1]; t++)
+				{
+					// every pair once
+					const int j = sortedIndex[t];
+					if (j <= i)
+						continue;
+					const double dx = sortedX[t] - xi, dy = sortedY[t] - yi;
+					const double dist2 = dx * dx + dy * dy;
+					if (dist2 < maxDist2)
+						visit(i, j, dx, dy, dist2);
+				}
+			}
+	}
+}
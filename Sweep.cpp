@@ -0,0 +1,52 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "Sweep.h"
+#include <chrono>
+
+std::vector<SweepPoint> MakeSweepGrid(const std::vector<int> &methods, const std::vector<double> &steps,
+	const std::vector<double> &stiffnesses, const std::vector<double> &masses, const std::vector<double> &dampings)
+{
+	std::vector<SweepPoint> points;
+	points.reserve(methods.size() * steps.size() * stiffnesses.size() * masses.size() * dampings.size());
+	for (size_t d = 0; d < dampings.size(); d++)
+		for (size_t m = 0; m < masses.size(); m++)
+			for (size_t k = 0; k < stiffnesses.size(); k++)
+				for (size_t s = 0; s < steps.size(); s++)
+					for (size_t i = 0; i < methods.size(); i++)
+					{
+						SweepPoint p;
+						p.method = methods[i];
+						p.step = steps[s];
+						p.stiffness = stiffnesses[k];
+						p.mass = masses[m];
+						p.damping = dampings[d];
+						points.push_back(p);
+					}
+	return points;
+}
+
+std::vector<SweepResult> RunSweep(const std::vector<SweepPoint> &points, const SweepFunction &fn, ThreadPool &pool)
+{
+	std::vector<SweepResult> results(points.size());
+	const SweepPoint *in = points.data();
+	SweepResult *out = results.data();
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		pool.Submit([in, out, i, &fn]
+		{
+			SweepResult &r = out[i];
+			r.point = in[i];
+			for (int j = 0; j < 4; j++)
+				r.value[j] = 0.0;
+			auto start = std::chrono::steady_clock::now();
+			fn(in[i], r);
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			r.seconds = elapsed.count();
+		});
+	}
+	pool.Wait();
+	return results;
+}
@@ -0,0 +1,38 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <functional>
+#include <vector>
+#include "ThreadPool.h"
+
+// One configuration of a parameter sweep
+struct SweepPoint
+{
+	int method;
+	double step;
+	double stiffness;
+	double mass;
+	double damping;
+};
+
+// Outputs of one configuration, the meaning of value[] is up to the experiment
+struct SweepResult
+{
+	SweepPoint point;
+	double value[4];
+	double seconds;
+};
+
+typedef std::function<void(const SweepPoint &point, SweepResult &result)> SweepFunction;
+
+// Cartesian product of the parameter values, methods vary fastest
+std::vector<SweepPoint> MakeSweepGrid(const std::vector<int> &methods, const std::vector<double> &steps,
+	const std::vector<double> &stiffnesses, const std::vector<double> &masses, const std::vector<double> &dampings);
+
+// Evaluates fn for every point on the pool and returns once all are done.
+// results[i] belongs to points[i], independent of the execution order.
+std::vector<SweepResult> RunSweep(const std::vector<SweepPoint> &points, const SweepFunction &fn, ThreadPool &pool);
@@ -0,0 +1,162 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "ThreadPool.h"
+
+// Index of the worker owning the current thread, -1 outside the pool
+static thread_local int workerIndex = -1;
+static thread_local const ThreadPool *workerPool = nullptr;
+
+ThreadPool::ThreadPool(int numThreads)
+	: queued(0), pending(0), nextQueue(0), stop(false)
+{
+	if (numThreads <= 0)
+		numThreads = (int)std::thread::hardware_concurrency();
+	if (numThreads <= 0)
+		numThreads = 1;
+
+	for (int i = 0; i < numThreads; i++)
+		queues.push_back(std::unique_ptr<Queue>(new Queue()));
+	for (int i = 0; i < numThreads; i++)
+		threads.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool(void)
+{
+	Wait();
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		stop = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+
+void ThreadPool::Submit(Task task)
+{
+	// Workers push to their own deque, everybody else distributes round robin
+	int q = (workerPool == this) ? workerIndex : (int)(nextQueue++ % queues.size());
+	pending++;
+	{
+		std::lock_guard<std::mutex> guard(queues[q]->lock);
+		queues[q]->tasks.push_back(std::move(task));
+	}
+	queued++;
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+	}
+	wake.notify_one();
+	done.notify_all();
+}
+
+bool ThreadPool::TryRun(int self)
+{
+	Task task;
+	const int n = (int)queues.size();
+
+	// Own deque first (most recently pushed task), then steal the oldest
+	// task of another worker
+	if (self >= 0)
+	{
+		Queue &q = *queues[self];
+		std::lock_guard<std::mutex> guard(q.lock);
+		if (!q.tasks.empty())
+		{
+			task = std::move(q.tasks.back());
+			q.tasks.pop_back();
+		}
+	}
+	for (int i = 1; !task && i <= n; i++)
+	{
+		Queue &q = *queues[(self + i + n) % n];
+		std::lock_guard<std::mutex> guard(q.lock);
+		if (!q.tasks.empty())
+		{
+			task = std::move(q.tasks.front());
+			q.tasks.pop_front();
+		}
+	}
+	if (!task)
+		return false;
+
+	queued--;
+	task();
+	if (--pending == 0)
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		done.notify_all();
+	}
+	return true;
+}
+
+void ThreadPool::WorkerLoop(int index)
+{
+	workerIndex = index;
+	workerPool = this;
+	for (;;)
+	{
+		if (TryRun(index))
+			continue;
+
+		std::unique_lock<std::mutex> guard(sleepLock);
+		wake.wait(guard, [this] { return stop || queued > 0; });
+		if (stop)
+			return;
+	}
+}
+
+void ThreadPool::Wait()
+{
+	int self = (workerPool == this) ? workerIndex : -1;
+	while (pending > 0)
+	{
+		if (TryRun(self))
+			continue;
+
+		std::unique_lock<std::mutex> guard(sleepLock);
+		done.wait(guard, [this] { return pending == 0 || queued > 0; });
+	}
+}
+
+void ThreadPool::ParallelFor(int begin, int end, int grain, const std::function<void(int, int)> &body)
+{
+	if (grain < 1)
+		grain = 1;
+	if (end - begin <= grain)
+	{
+		if (end > begin)
+			body(begin, end);
+		return;
+	}
+
+	std::atomic<int> remaining((end - begin + grain - 1) / grain);
+	std::mutex lock;
+	std::condition_variable finished;
+	for (int first = begin; first < end; first += grain)
+	{
+		int last = (first + grain < end) ? first + grain : end;
+		Submit([&, first, last]
+		{
+			body(first, last);
+			std::lock_guard<std::mutex> guard(lock);
+			if (--remaining == 0)
+				finished.notify_all();
+		});
+	}
+
+	// Help out until our own chunks are done; other tasks in the pool are
+	// not waited for
+	int self = (workerPool == this) ? workerIndex : -1;
+	while (remaining > 0)
+	{
+		if (TryRun(self))
+			continue;
+		std::unique_lock<std::mutex> guard(lock);
+		finished.wait_for(guard, std::chrono::microseconds(100), [&] { return remaining == 0; });
+	}
+	// The last chunk may still hold the lock it notified under
+	std::lock_guard<std::mutex> guard(lock);
+}
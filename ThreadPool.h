@@ -0,0 +1,61 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads. Every worker owns a task deque; it pops
+// its own tasks from the back and steals from the front of the other deques
+// when it runs dry, so uneven task costs still keep all cores busy.
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	// numThreads <= 0 uses one thread per hardware core
+	explicit ThreadPool(int numThreads = 0);
+	~ThreadPool(void);
+
+	int ThreadCount() const { return (int)threads.size(); }
+
+	// Queue a task. Tasks may submit further tasks.
+	void Submit(Task task);
+	// Block until every submitted task has finished. The calling thread
+	// executes queued tasks while it waits.
+	void Wait();
+	// Run body(first, last) over [begin, end) in chunks of at most grain
+	// indices and wait for completion
+	void ParallelFor(int begin, int end, int grain, const std::function<void(int, int)> &body);
+
+private:
+	struct Queue
+	{
+		std::mutex lock;
+		std::deque<Task> tasks;
+	};
+
+	bool TryRun(int self);
+	void WorkerLoop(int index);
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> threads;
+
+	std::atomic<int> queued;	// tasks waiting in a deque
+	std::atomic<int> pending;	// tasks submitted but not finished
+	std::atomic<unsigned> nextQueue;
+	bool stop;
+
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	std::condition_variable done;
+};
@@ -0,0 +1,108 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "TrajectoryWriter.h"
+#include <string.h>
+
+// Records are collected in memory and written in large blocks
+static const size_t BUFFER_SIZE = 1 << 20;
+static const uint32_t HEADER_SIZE = 64;
+
+TrajectoryWriter::TrajectoryWriter(void)
+	: file(nullptr), failed(false), samples(0), used(0)
+{
+}
+
+TrajectoryWriter::~TrajectoryWriter(void)
+{
+	Close();
+}
+
+bool TrajectoryWriter::Open(const char *filename, const TrajectoryHeader &_header)
+{
+	Close();
+	failed = false;
+	file = fopen(filename, "wb");
+	if (!file)
+		return false;
+
+	header = _header;
+	if (header.valueSize != 8)
+		header.valueSize = 4;
+	if (header.stride < 1)
+		header.stride = 1;
+	samples = 0;
+	size_t recordSize = (header.channels + 1) * header.valueSize;
+	buffer.resize(recordSize > BUFFER_SIZE ? recordSize : BUFFER_SIZE);
+	used = 0;
+
+	unsigned char raw[HEADER_SIZE];
+	memset(raw, 0, sizeof(raw));
+	memcpy(raw, "MSPTRAJ1", 8);
+	memcpy(raw + 8, &HEADER_SIZE, 4);
+	memcpy(raw + 12, &header.valueSize, 4);
+	memcpy(raw + 16, &header.channels, 4);
+	memcpy(raw + 20, &header.stride, 4);
+	memcpy(raw + 24, &header.method, 4);
+	memcpy(raw + 28, &header.testcase, 4);
+	memcpy(raw + 32, &header.stiffness, 8);
+	memcpy(raw + 40, &header.mass, 8);
+	memcpy(raw + 48, &header.damping, 8);
+	memcpy(raw + 56, &header.step, 8);
+	if (fwrite(raw, 1, sizeof(raw), file) != sizeof(raw))
+	{
+		fclose(file);
+		file = nullptr;
+		failed = true;
+		return false;
+	}
+	return true;
+}
+
+bool TrajectoryWriter::Close()
+{
+	if (!file)
+		return true;
+	Flush();
+	// buffered data may only fail to reach the disk here
+	if (fclose(file) != 0)
+		failed = true;
+	file = nullptr;
+	return !failed;
+}
+
+void TrajectoryWriter::Write(double t, const double *values)
+{
+	if (!file || failed || (samples++ % header.stride) != 0)
+		return;
+
+	if (used + (header.channels + 1) * header.valueSize > buffer.size())
+		Flush();
+	Put(t);
+	for (uint32_t i = 0; i < header.channels; i++)
+		Put(values[i]);
+}
+
+inline void TrajectoryWriter::Put(double value)
+{
+	if (header.valueSize == 8)
+	{
+		memcpy(&buffer[used], &value, 8);
+		used += 8;
+	}
+	else
+	{
+		float f = (float)value;
+		memcpy(&buffer[used], &f, 4);
+		used += 4;
+	}
+}
+
+void TrajectoryWriter::Flush()
+{
+	if (used > 0 && !failed && fwrite(buffer.data(), 1, used, file) != used)
+		failed = true;
+	used = 0;
+}
@@ -0,0 +1,71 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+// Binary trajectory file, all values in the byte order of the writing host:
+//
+//   header (64 bytes)
+//     offset 0   char     magic[8]		"MSPTRAJ1"
+//     offset 8   uint32   headerSize		64
+//     offset 12  uint32   valueSize		4 (float) or 8 (double)
+//     offset 16  uint32   channels		values per record, not counting the time
+//     offset 20  uint32   stride			every stride-th sample was written
+//     offset 24  int32    method			Scene::Method
+//     offset 28  int32    testcase		Scene::Testcase
+//     offset 32  double   stiffness, mass, damping, step
+//   records until the end of the file
+//     value    t, channel[0] ... channel[channels - 1]
+//
+// Measurements/read_trajectory.py loads such a file into numpy arrays; it
+// expects the little-endian files of x86 and ARM hosts.
+struct TrajectoryHeader
+{
+	uint32_t valueSize;
+	uint32_t channels;
+	uint32_t stride;
+	int32_t method;
+	int32_t testcase;
+	double stiffness, mass, damping, step;
+
+	TrajectoryHeader(void) : valueSize(4), channels(0), stride(1), method(0), testcase(0),
+		stiffness(0), mass(0), damping(0), step(0) {}
+};
+
+// Buffered writer for the format above
+class TrajectoryWriter
+{
+public:
+	TrajectoryWriter(void);
+	~TrajectoryWriter(void);
+
+	// Returns false if the file cannot be created or its header not written
+	bool Open(const char *filename, const TrajectoryHeader &header);
+	// Returns false if any write to the file failed, true if none was open
+	bool Close();
+	bool IsOpen() const { return file != nullptr; }
+	// A write failed since Open; the records after it are dropped
+	bool Failed() const { return failed; }
+	int Channels() const { return (int)header.channels; }
+
+	// Record one sample of Channels() values; only every stride-th sample
+	// ends up in the file
+	void Write(double t, const double *values);
+
+private:
+	void Put(double value);
+	void Flush();
+
+	FILE *file;
+	bool failed;
+	TrajectoryHeader header;
+	uint64_t samples;
+	std::vector<unsigned char> buffer;
+	size_t used;
+};
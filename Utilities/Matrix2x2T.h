@@ -36,6 +36,15 @@ public:
 		m_elem[1][1] = p.m_elem[1][1];
 	}
 
+	// Assignment-operator
+	Matrix2x2T &operator=(const Matrix2x2T &p) {
+		m_elem[0][0] = p.m_elem[0][0];
+		m_elem[0][1] = p.m_elem[0][1];
+		m_elem[1][0] = p.m_elem[1][0];
+		m_elem[1][1] = p.m_elem[1][1];
+		return *this;
+	}
+
 	// Returns 2
 	static int rows() { return 2; }
 
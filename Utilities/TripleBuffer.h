@@ -0,0 +1,54 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <atomic>
+
+// Lock-free hand-over of the latest value from one writer thread to one
+// reader thread. The writer fills its private slot and publishes it by
+// swapping it with the shared middle slot, the reader swaps the middle slot
+// with its own when something new was published. Neither side ever waits
+// and the reader always sees a completely written value.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : middle(1), writeIndex(0), readIndex(2) {}
+
+	// Writer side: the slot to fill next, then Publish() it
+	T &Write() { return slots[writeIndex]; }
+	void Publish()
+	{
+		int previous = middle.exchange(writeIndex | fresh, std::memory_order_acq_rel);
+		writeIndex = previous & indexMask;
+	}
+
+	// Reader side: takes the latest published slot, returns false if nothing
+	// new was published since the last call
+	bool Update()
+	{
+		if (!(middle.load(std::memory_order_relaxed) & fresh))
+			return false;
+		int previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+		readIndex = previous & indexMask;
+		return true;
+	}
+	const T &Read() const { return slots[readIndex]; }
+
+private:
+	TripleBuffer(const TripleBuffer &);
+	TripleBuffer &operator=(const TripleBuffer &);
+
+	static const int indexMask = 3;
+	static const int fresh = 4;
+
+	T slots[3];
+	// index of the middle slot, plus the fresh flag while unread
+	std::atomic<int> middle;
+	// owned by the writer and the reader thread respectively
+	int writeIndex;
+	int readIndex;
+};
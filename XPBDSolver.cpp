@@ -0,0 +1,90 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#include "XPBDSolver.h"
+#include "Exercise.h"
+#include "Profiler.h"
+#include <math.h>
+
+void XPBDSolver::Step(ParticleSystem &ps, double d, double _dt)
+{
+	const int n = ps.ParticleCount();
+	dt = _dt;
+
+	// predict with everything but the springs and the ground
+	{
+		PROFILE_SCOPE("Forces");
+		ps.ClearForces();
+		ps.AddDampingForces(d);
+	}
+	ps.AddContactForces();
+
+	{
+		PROFILE_SCOPE("Integrate");
+		prevX = ps.x;
+		prevY = ps.y;
+		for (int i = 0; i < n; i++)
+		{
+			const double w = ps.invMass[i];
+			if (w == 0.0)
+				continue;
+			ps.vx[i] += dt * w * ps.fx[i];
+			ps.vy[i] += dt * (w * ps.fy[i] - gravity);
+			ps.x[i] += dt * ps.vx[i];
+			ps.y[i] += dt * ps.vy[i];
+		}
+	}
+
+	{
+		PROFILE_SCOPE("Solve");
+		lambda.assign(ps.SpringCount(), 0.0);
+		for (int it = 0; it < iterations; it++)
+		{
+			ps.ForEachSpringBatch([this, &ps](int first, int last) { ProjectSprings(ps, first, last); });
+			for (int i = 0; i < n; i++)
+				if (ps.y[i] < groundHeight && ps.invMass[i] != 0.0)
+					ps.y[i] = groundHeight;
+		}
+	}
+
+	PROFILE_SCOPE("Integrate");
+	const double invDt = 1.0 / dt;
+	for (int i = 0; i < n; i++)
+	{
+		if (ps.invMass[i] == 0.0)
+			continue;
+		ps.vx[i] = (ps.x[i] - prevX[i]) * invDt;
+		ps.vy[i] = (ps.y[i] - prevY[i]) * invDt;
+	}
+}
+
+void XPBDSolver::ProjectSprings(ParticleSystem &ps, int first, int last)
+{
+	const double invDt2 = 1.0 / (dt * dt);
+	for (int s = first; s < last; s++)
+	{
+		const int a = ps.springA[s];
+		const int b = ps.springB[s];
+		const double wa = ps.invMass[a], wb = ps.invMass[b];
+		// time-step scaled compliance
+		const double alpha = invDt2 / ps.springK[s];
+		if (wa + wb + alpha == 0.0)
+			continue;
+
+		double dx = ps.x[b] - ps.x[a];
+		double dy = ps.y[b] - ps.y[a];
+		double len = sqrt(dx * dx + dy * dy);
+		if (len == 0.0)
+			continue;
+		const double C = len - ps.restLength[s];
+		const double dLambda = (-C - alpha * lambda[s]) / (wa + wb + alpha);
+		lambda[s] += dLambda;
+
+		// gradients -n for a and n for b
+		const double nx = dx / len, ny = dy / len;
+		ps.x[a] -= wa * dLambda * nx; ps.y[a] -= wa * dLambda * ny;
+		ps.x[b] += wb * dLambda * nx; ps.y[b] += wb * dLambda * ny;
+	}
+}
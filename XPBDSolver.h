@@ -0,0 +1,39 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+#pragma once
+
+#include <vector>
+#include "ParticleSystem.h"
+
+// Extended position based dynamics (Macklin et al. 2016). Every spring is a
+// distance constraint with compliance 1/k. A step predicts the positions from
+// the external forces, projects the constraints in Gauss-Seidel sweeps and
+// derives the velocities from the position change, so it stays stable at
+// frame-rate steps for any stiffness. The ground is a hard constraint.
+//
+// The spring colors of ParticleSystem::ColorSprings let the constraints of
+// one color be projected in parallel; the result does not depend on the
+// thread count.
+class XPBDSolver
+{
+public:
+	// Gauss-Seidel sweeps over all constraints per step
+	int iterations;
+
+	XPBDSolver(void) : iterations(10), dt(0.0) {}
+
+	void Step(ParticleSystem &ps, double d, double dt);
+
+private:
+	void ProjectSprings(ParticleSystem &ps, int first, int last);
+
+	// step of the current Step call; a member rather than a capture, so the
+	// sweep callback fits into std::function without allocating
+	double dt;
+	std::vector<double> prevX, prevY;
+	// accumulated multiplier of every spring in the current step
+	std::vector<double> lambda;
+};
@@ -0,0 +1,349 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+// Benchmarks of the integrators and scenes:
+//  - spring1/<method>: one AdvanceTimeStep1 step of the hanging mass point
+//  - ensemble/<method>/batch and ensemble/<method>/scalar: one step of 1024
+//    hanging mass points with their own parameters, advanced several per
+//    instruction by AdvanceTimeStep1Batch and one by one by the Spring1Run
+//    kernel of the spring1d testcase
+//  - triangle/backwards_euler: one AdvanceTimeStep3 step of the triangle
+//  - mesh/<method>/<n>x<n>: one step of an n x n cloth: backwards_euler
+//    (AdvanceTimeStep3), implicit_euler, and projective_dynamics with the
+//    factor computed beforehand
+//
+// Every benchmark is calibrated so that a sample takes about -time seconds,
+// warmed up once at that iteration count and then sampled -samples times with
+// the count pinned. Every sample starts from the same initial state, so all
+// samples time the same stretch of the simulation. Results are ns per step;
+// -json writes them for regression tracking.
+
+#include "Scene.h"
+#include "Exercise.h"
+#include "Integrators.h"
+#include "Ensemble.h"
+#include "ParticleSystem.h"
+#include "ImplicitSolver.h"
+#include "ProjectiveSolver.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <math.h>
+
+using namespace std;
+
+typedef std::chrono::steady_clock Clock;
+// Runs the given number of steps
+typedef std::function<void(long)> Body;
+
+struct BenchResult
+{
+	string name;
+	int particles;
+	long iterations;
+	vector<double> samples;	// ns per step
+	double mean, median, stddev, min;
+};
+
+static int numSamples = 10;
+static double sampleSeconds = 0.05;
+static int numThreads = 0;
+static const char *jsonFile = nullptr;
+static const char *filter = nullptr;
+
+// Keeps the benchmarked results alive
+static volatile double sink;
+
+static double Time(const Body &run, long iterations)
+{
+	Clock::time_point start = Clock::now();
+	run(iterations);
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void Measure(const string &name, int particles, const Body &run, vector<BenchResult> &results)
+{
+	if (filter && !strstr(name.c_str(), filter))
+		return;
+
+	// grow the iteration count until one sample takes long enough, this
+	// also warms up caches and the branch predictors
+	long iterations = 1;
+	for (;;)
+	{
+		double t = Time(run, iterations);
+		if (t >= sampleSeconds)
+			break;
+		long next = (t > 0.0) ? (long)ceil(1.2 * iterations * sampleSeconds / t) : 10 * iterations;
+		iterations = std::min(next, 10 * iterations);
+	}
+	Time(run, iterations);
+
+	BenchResult r;
+	r.name = name;
+	r.particles = particles;
+	r.iterations = iterations;
+	for (int s = 0; s < numSamples; s++)
+		r.samples.push_back(Time(run, iterations) * 1e9 / iterations);
+
+	vector<double> sorted = r.samples;
+	sort(sorted.begin(), sorted.end());
+	const int n = (int)sorted.size();
+	r.min = sorted[0];
+	r.median = (n % 2) ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+	double sum = 0.0, sum2 = 0.0;
+	for (int s = 0; s < n; s++)
+		sum += sorted[s];
+	r.mean = sum / n;
+	for (int s = 0; s < n; s++)
+		sum2 += (sorted[s] - r.mean) * (sorted[s] - r.mean);
+	r.stddev = (n > 1) ? sqrt(sum2 / (n - 1)) : 0.0;
+
+	printf("%-36s %9d %10ld %14.2f %14.2f %12.2f\n", r.name.c_str(), r.particles, r.iterations, r.mean, r.median, r.stddev);
+	fflush(stdout);
+	results.push_back(r);
+}
+
+// Hanging mass point with the defaults of the spring1d testcase
+static void BenchSpring1(vector<BenchResult> &results)
+{
+	const double k = 10.0, m = 0.1, d = 0.01, L = 1.0, dt = 0.003;
+	const double p1 = 0.0, start = -1.0;
+	for (int method = 1; method < METHODS_NUM; method++)
+	{
+		Body run = [=](long n)
+		{
+			double p2 = start, v2 = 0.0;
+			// restart every 1000 steps, so unstable methods stay finite
+			for (long i = 0; i < n; i += 1000)
+			{
+				p2 = start; v2 = 0.0;
+				Spring1State state(p2, v2);
+				const long chunk = std::min(1000L, n - i);
+				for (long j = 0; j < chunk; j++)
+					AdvanceTimeStep1(k, m, d, L, dt, method, p1, 0.0, p2, v2, state);
+			}
+			sink = p2;
+		};
+		Measure(string("spring1/") + methodNames[method], 2, run, results);
+	}
+}
+
+// Ensemble of hanging mass points, batched against the scalar kernels.
+// analytic and adaptive_rk23 are skipped: the batch takes fixed steps from
+// the current state, the scalar kernels do not.
+static void BenchEnsemble(vector<BenchResult> &results)
+{
+	const int n = 1024;
+	const double dt = 0.003, p1 = 0.0, start = -1.0;
+	vector<double> k(n), m(n), d(n), L(n, 1.0), p2(n), v2(n);
+	for (int i = 0; i < n; i++)
+	{
+		k[i] = 10.0 + 0.01 * i;
+		m[i] = 0.1;
+		d[i] = 0.01;
+	}
+	vector<Spring1State> states(n);
+	for (int method = 1; method < METHODS_NUM; method++)
+	{
+		if (method == Scene::ANALYTIC || method == Scene::ADAPTIVE_RK23)
+			continue;
+		// restart every 1000 steps, so unstable methods stay finite
+		Body batchRun = [&](long count)
+		{
+			for (long i = 0; i < count; i++)
+			{
+				if (i % 1000 == 0)
+				{
+					fill(p2.begin(), p2.end(), start);
+					fill(v2.begin(), v2.end(), 0.0);
+				}
+				AdvanceTimeStep1Batch(&k[0], &m[0], &d[0], &L[0], dt, method, p1, &p2[0], &v2[0], n);
+			}
+			sink = p2[n - 1];
+		};
+		Measure(string("ensemble/") + methodNames[method] + "/batch", n + 1, batchRun, results);
+
+		const Spring1Kernel kernel = SelectKernel<Spring1Run>(method);
+		Body scalarRun = [&](long count)
+		{
+			for (long i = 0; i < count; i++)
+			{
+				if (i % 1000 == 0)
+				{
+					fill(p2.begin(), p2.end(), start);
+					fill(v2.begin(), v2.end(), 0.0);
+				}
+				for (int j = 0; j < n; j++)
+					kernel(k[j], m[j], d[j], L[j], dt, p1, p2[j], v2[j], 1, states[j]);
+			}
+			sink = p2[n - 1];
+		};
+		Measure(string("ensemble/") + methodNames[method] + "/scalar", n + 1, scalarRun, results);
+	}
+}
+
+// Falling triangle of the falling testcase
+static void BenchTriangle(vector<BenchResult> &results)
+{
+	ParticleSystem initial, ps;
+	initial.radius = Scene::Config().radius;
+	for (int i = 0; i < 3; i++)
+	{
+		double angle = (90.0 + 120.0 * i) / 180.0 * M_PI;
+		initial.AddParticle(cos(angle), sin(angle), 0.1, false);
+	}
+	for (int i = 0; i < 3; i++)
+		initial.AddSpring(i, (i + 1) % 3, 10.0);
+
+	Body run = [&](long n)
+	{
+		ps = initial;
+		for (long i = 0; i < n; i++)
+			AdvanceTimeStep3(0.01, 0.003, ps);
+		sink = ps.y[0];
+	};
+	Measure(string("triangle/") + methodNames[Scene::BACK_EULER], initial.ParticleCount(), run, results);
+}
+
+// Cloth of n x n points as built by the cloth testcase with the default
+// settings of bench
+static void MakeCloth(ParticleSystem &ps, int n)
+{
+	Scene::Config config;
+	config.testcase = Scene::CLOTH;
+	config.xPoints = config.yPoints = n;
+	config.mass = 0.1;
+	config.stiffness = 10.0;
+	ps.Clear();
+	Scene::CreateCloth(ps, config);
+}
+
+static void BenchMeshes(vector<BenchResult> &results, ThreadPool &pool)
+{
+	const int sizes[3] = { 16, 64, 256 };
+	for (int s = 0; s < 3; s++)
+	{
+		const int n = sizes[s];
+		const string size = "/" + to_string(n) + "x" + to_string(n);
+
+		ParticleSystem initial, ps;
+		MakeCloth(initial, n);
+		if (initial.SpringCount() >= ParticleSystem::parallelSprings)
+		{
+			initial.ColorSprings();
+			initial.pool = &pool;
+		}
+
+		Body explicitRun = [&](long count)
+		{
+			ps = initial;
+			for (long i = 0; i < count; i++)
+				AdvanceTimeStep3(0.01, 0.003, ps);
+			sink = ps.y[0];
+		};
+		Measure(string("mesh/") + methodNames[Scene::BACK_EULER] + size, initial.ParticleCount(), explicitRun, results);
+
+		ImplicitEulerSolver solver;
+		Body implicitRun = [&](long count)
+		{
+			ps = initial;
+			for (long i = 0; i < count; i++)
+				solver.Step(ps, 0.01, 0.003);
+			sink = ps.y[0];
+		};
+		Measure(string("mesh/") + methodNames[Scene::IMPLICIT_EULER] + size, initial.ParticleCount(), implicitRun, results);
+
+		ProjectiveDynamicsSolver projective;
+		projective.Prepare(initial, 0.003);
+		Body projectiveRun = [&](long count)
+		{
+			ps = initial;
+			for (long i = 0; i < count; i++)
+				projective.Step(ps, 0.01, 0.003);
+			sink = ps.y[0];
+		};
+		Measure(string("mesh/") + methodNames[Scene::PROJECTIVE_DYNAMICS] + size, initial.ParticleCount(), projectiveRun, results);
+	}
+}
+
+static bool WriteJson(const char *fileName, const vector<BenchResult> &results, int threads)
+{
+	FILE *file = fopen(fileName, "w");
+	if (!file)
+		return false;
+	fprintf(file, "{\n  \"unit\": \"ns/step\",\n  \"threads\": %d,\n  \"ensembleLanes\": %d,\n  \"samples\": %d,\n  \"benchmarks\": [",
+		threads, EnsembleLaneWidth(), numSamples);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult &r = results[i];
+		fprintf(file, "%s\n    {\"name\": \"%s\", \"particles\": %d, \"iterations\": %ld, "
+			"\"mean\": %.4f, \"median\": %.4f, \"stddev\": %.4f, \"min\": %.4f, \"samples\": [",
+			i ? "," : "", r.name.c_str(), r.particles, r.iterations, r.mean, r.median, r.stddev, r.min);
+		for (size_t s = 0; s < r.samples.size(); s++)
+			fprintf(file, "%s%.4f", s ? ", " : "", r.samples[s]);
+		fprintf(file, "]}");
+	}
+	fprintf(file, "\n  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+int main(int argc, char** argv)
+{
+	for (int arg = 1; arg < argc; arg++)
+	{
+		if (!strcmp(argv[arg], "-samples") && arg + 1 < argc)
+			numSamples = atoi(argv[++arg]);
+		else if (!strcmp(argv[arg], "-time") && arg + 1 < argc)
+			sampleSeconds = atof(argv[++arg]);
+		else if (!strcmp(argv[arg], "-threads") && arg + 1 < argc)
+			numThreads = atoi(argv[++arg]);
+		else if (!strcmp(argv[arg], "-json") && arg + 1 < argc)
+			jsonFile = argv[++arg];
+		else if (!strcmp(argv[arg], "-filter") && arg + 1 < argc)
+			filter = argv[++arg];
+		else
+		{
+			cerr << endl << "Unrecognized option " << argv[arg] << endl;
+			cerr << "Usage: bench -[option1] [settings] -[option2] [settings] ..." << endl;
+			cerr << "Options:" << endl;
+			cerr << "\t-samples [pinned samples per benchmark]" << endl;
+			cerr << "\t-time [seconds per sample]" << endl;
+			cerr << "\t-threads [workers for large meshes, 0 = all cores]" << endl;
+			cerr << "\t-json [result file]" << endl;
+			cerr << "\t-filter [run benchmarks whose name contains this]" << endl << endl;
+			return EXIT_FAILURE;
+		}
+	}
+	if (numSamples < 1 || sampleSeconds <= 0.0)
+	{
+		cerr << "Need at least one sample of positive duration" << endl;
+		return EXIT_FAILURE;
+	}
+
+	ThreadPool pool(numThreads);
+	vector<BenchResult> results;
+	// fixed at compile time, see Ensemble.h
+	printf("ensemble lanes: %d\n", EnsembleLaneWidth());
+	printf("%-36s %9s %10s %14s %14s %12s\n", "benchmark", "particles", "iterations", "mean [ns]", "median [ns]", "stddev [ns]");
+	BenchSpring1(results);
+	BenchEnsemble(results);
+	BenchTriangle(results);
+	BenchMeshes(results, pool);
+
+	if (jsonFile && !WriteJson(jsonFile, results, pool.ThreadCount()))
+	{
+		cerr << "Cannot write " << jsonFile << endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
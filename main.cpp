@@ -10,72 +10,42 @@
 #endif
 
 #include "Scene.h"
-
-// timers 
-#if defined(__APPLE__)
-#include <CoreServices/CoreServices.h>
-#elif defined(_WIN32)
-#include <Windows.h>
-#else
-#include <time.h>
-#include <sys/time.h>
-#include <sys/times.h>
-#endif
+#include "SceneBatch.h"
+#include "SimulationThread.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
 
 Scene *sc = nullptr;
-unsigned int lastTick = 0;
-unsigned int stepping = 10000;
-double mspt;
-
-// windows only
-void timerInit()
-{
-#if defined(__linux__)
-	// nothing to do...
-#elif defined(_WIN32)
-	LARGE_INTEGER tps_long;
-	QueryPerformanceFrequency(&tps_long);
-	mspt = 1e6 / (double)tps_long.QuadPart;
-#endif
-}
+// Written at exit, after the scene is gone
+std::string traceFile;
+SimulationThread simThread;
 
-unsigned int getTime()
-{
-#if defined(__APPLE__) // OS X
-	UnsignedWide uCur;
-	Microseconds(&uCur);
-	return uCur.lo;
-#elif defined(__linux__) // Linux
-	struct timeval tv;
-	struct timezone tz;
-	tz.tz_minuteswest = 0;
-	tz.tz_dsttime = 0;
-	gettimeofday(&tv, &tz);
-	return (unsigned int)((tv.tv_sec * 1000) + (tv.tv_usec / 1000)) * 10000;
-#else // Windows
-	LARGE_INTEGER tick;
-	QueryPerformanceCounter(&tick);
-	return (unsigned int)(mspt*tick.QuadPart);
-#endif
-}
+// Frame scheduling
+const double framesPerSecond = 60.0;
+// Substeps per wake-up at most; a simulation slower than real time falls
+// behind instead of piling up work
+const int maxSubsteps = 10;
+Clock::time_point nextFrame;
 
 void display(void)
 {
 	// Clear the screen
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	unsigned int tm = getTime();
-	if (tm - lastTick > stepping)
-	{
-		lastTick += stepping;
-		sc->Update();
-	}
+	if (sc->Finished())
+		exit(0);
 	sc->Render();
 
 	// Draw everything to the screen
 	glFlush();
-	// Start drawing again
-	glutPostRedisplay();
 	glutSwapBuffers();
 }
 
@@ -84,14 +54,178 @@ void reshape(int width, int height)
 	glViewport(0, 0, width, height);
 }
 
-void idle(void)
+// Redraw at the frame rate; GLUT sleeps in its event loop in between
+void frameTimer(int)
 {
+	const Clock::duration frame = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond));
+	Clock::time_point now = Clock::now();
+	nextFrame = StepScheduler::NextDeadline(nextFrame, frame, now);
 	glutPostRedisplay();
+	glutTimerFunc((unsigned)std::chrono::duration_cast<std::chrono::milliseconds>(nextFrame - now).count(), frameTimer, 0);
+}
+
+// Advance the scene as fast as possible without creating a window
+int runHeadless()
+{
+	Clock::time_point start = Clock::now();
+	int steps = 0;
+	while (steps < sc->config.numSteps && !sc->Finished())
+	{
+		sc->Update();
+		steps++;
+	}
+	std::chrono::duration<double> elapsed = Clock::now() - start;
+
+	std::cerr << steps << " steps in " << elapsed.count() << " s";
+	if (elapsed.count() > 0)
+		std::cerr << " (" << steps / elapsed.count() << " steps/s)";
+	std::cerr << std::endl;
+	return sc->CloseOutput() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// GLUT leaves its main loop through exit(), make sure the scene still
+// flushes its output
+void cleanup()
+{
+	simThread.Stop();
+	if (sc)
+	{
+		sc->PrintStatistics();
+		sc->CloseOutput();
+	}
+	delete sc;
+	sc = nullptr;
+
+#ifdef ENABLE_PROFILING
+	// every thread has stopped recording by now
+	if (!Profiler::Empty())
+		Profiler::PrintSummary(std::cerr);
+	if (!traceFile.empty() && !Profiler::WriteTrace(traceFile.c_str()))
+		std::cerr << "Cannot write trace file " << traceFile << std::endl;
+#endif
+}
+
+// Output file of one scene of a batch: the method name goes before the
+// extension, trajectory.bin becomes trajectory_euler.bin
+static std::string BatchFileName(const std::string &outFile, const char *method)
+{
+	std::string name(outFile);
+	size_t dot = name.rfind('.');
+	size_t slash = name.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		dot = name.size();
+	return name.substr(0, dot) + "_" + method + name.substr(dot);
+}
+
+// Runs the testcase once for every method of -batch, all scenes in this
+// process and stepped together on one pool
+int runBatch(const Scene::Config &config)
+{
+	if (Scene::IsMeasurement(config.testcase))
+	{
+		std::cerr << "Measurement testcases already cover all methods, -batch needs an animated testcase" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<int> methods;
+	std::string list(config.batch);
+	for (size_t start = 0; start <= list.size();)
+	{
+		size_t end = list.find(',', start);
+		if (end == std::string::npos)
+			end = list.size();
+		std::string name = list.substr(start, end - start);
+		int method = 0;
+		for (int i = 1; i < METHODS_NUM; i++)
+			if (name == methodNames[i])
+				method = i;
+		if (!method)
+		{
+			std::cerr << "Unrecognized method " << name << " in -batch" << std::endl;
+			return EXIT_FAILURE;
+		}
+		// a method without its own integrator would rerun another one under
+		// its name, e.g. analytic on a spring network
+		if (!Scene::Supports(config.testcase, (Scene::Method)method))
+		{
+			std::cerr << "Method " << name << " has no integrator for the " << testcaseNames[config.testcase] << " testcase, remove it from -batch" << std::endl;
+			return EXIT_FAILURE;
+		}
+		// the scenes would write the same output file
+		if (std::find(methods.begin(), methods.end(), method) != methods.end())
+		{
+			std::cerr << "Method " << name << " given twice in -batch" << std::endl;
+			return EXIT_FAILURE;
+		}
+		methods.push_back(method);
+		start = end + 1;
+	}
+
+	ThreadPool pool(config.numThreads);
+	SceneBatch batch(pool);
+	for (size_t i = 0; i < methods.size(); i++)
+	{
+		Scene::Config c = config;
+		c.method = (Scene::Method)methods[i];
+		if (!config.outFile.empty())
+			c.outFile = BatchFileName(config.outFile, methodNames[methods[i]]);
+		c.batch.clear();
+		try
+		{
+			batch.Add(c);
+		}
+		catch (const std::exception &e)
+		{
+			std::cerr << "Cannot set up the " << methodNames[methods[i]] << " scene: " << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	Clock::time_point start = Clock::now();
+	batch.Step(config.numSteps);
+	std::chrono::duration<double> elapsed = Clock::now() - start;
+
+	bool written = true;
+	for (int i = 0; i < batch.Count(); i++)
+	{
+		batch[i].PrintStatistics();
+		written = batch[i].CloseOutput() && written;
+	}
+	const double steps = (double)batch.Count() * config.numSteps;
+	std::cerr << batch.Count() << " scenes x " << config.numSteps << " steps in " << elapsed.count() << " s";
+	if (elapsed.count() > 0)
+		std::cerr << " (" << steps / elapsed.count() << " steps/s on " << pool.ThreadCount() << " threads)";
+	std::cerr << std::endl;
+	return written ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 int main(int argc, char** argv)
 {
-	sc = new Scene(argc, argv);
+	Scene::Config config = Scene::ParseArguments(argc, argv);
+	traceFile = config.traceFile;
+	atexit(cleanup);
+#ifndef ENABLE_PROFILING
+	if (!traceFile.empty())
+		std::cerr << "Built without ENABLE_PROFILING, no trace is written" << std::endl;
+#endif
+
+	if (!config.batch.empty())
+		return runBatch(config);
+
+	try
+	{
+		sc = new Scene(config);
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	sc->PrintSettings();
+	if (config.headless)
+	{
+		return runHeadless();
+	}
 
 	glutInit(&argc, argv);
 
@@ -101,13 +235,12 @@ int main(int argc, char** argv)
 
 	glutDisplayFunc(display);
 	glutReshapeFunc(reshape);
-	glutIdleFunc(idle);
-	timerInit();
-	lastTick = getTime();
+	nextFrame = Clock::now();
+	glutTimerFunc(0, frameTimer, 0);
+	simThread.Start(*sc, maxSubsteps);
 
 	glEnable(GL_LINE_SMOOTH);
 	glutMainLoop();
-	delete sc;
 
 	return EXIT_SUCCESS;
 }
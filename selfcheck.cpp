@@ -0,0 +1,734 @@
+//=============================================================================
+//  Physically-based Simulation in Computer Graphics
+//  ETH Zurich
+//=============================================================================
+
+// Headless checks of code whose output the animated scenes do not verify,
+// registered with ctest in CMakeLists.txt:
+//  - cholesky: SparseCholesky on the projective dynamics matrix of a small
+//    cloth, residual of both solves and a non positive definite matrix, then
+//    one projective dynamics step against implicit Euler and a refactor after
+//    a topology change
+//  - ensemble: AdvanceTimeStep1Batch against the scalar spring1d kernels
+//  - network_methods: the explicit methods on a hanging cloth converge with
+//    their order against a fine RK4 solution, and no two method names run
+//    the same integrator
+//  - reset: every method runs a scene, resets it and runs it again; both
+//    trajectories must be bitwise identical and the second run must not
+//    allocate, also for a cloth large enough to have its springs colored; a
+//    cloth reset to another network of the same size must match a fresh
+//    scene
+//  - render: draws a cloth scene into an offscreen EGL pbuffer, e.g. on Mesa
+//    llvmpipe, and checks for GL errors and the drawn springs and points;
+//    built only when EGL is found
+//  - scheduler: StepScheduler driven by a fake clock
+//  - simulation_thread: a scene stepped by SimulationThread in real time
+//    while this thread draws it, if an offscreen context is available, then
+//    stopped and joined
+//
+// Usage: selfcheck <check>. Prints what failed and exits with a failure
+// status if the check does not pass, with skipStatus if the machine cannot
+// run it.
+
+#include "Scene.h"
+#include "ParticleSystem.h"
+#include "SparseCholesky.h"
+#include "ImplicitSolver.h"
+#include "ExplicitSolver.h"
+#include "Exercise.h"
+#include "Integrators.h"
+#include "Ensemble.h"
+#include "ProjectiveSolver.h"
+#include "SimulationThread.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <math.h>
+#include <new>
+
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#endif
+
+using namespace std;
+
+// Exit status of checks the machine cannot run, see SKIP_RETURN_CODE in
+// CMakeLists.txt
+static const int skipStatus = 77;
+
+// Counts the operator new calls while countAllocations is set
+static atomic<bool> countAllocations(false);
+static atomic<long> allocations(0);
+
+void *operator new(size_t size)
+{
+	if (countAllocations)
+		allocations++;
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+// Reports a failed condition and keeps going, so one run lists all failures
+static bool Expect(bool condition, const string &what)
+{
+	if (!condition)
+		cerr << "FAILED: " << what << endl;
+	return condition;
+}
+
+// Symmetric matrix in compressed columns with both triangles stored, the
+// input format of SparseCholesky::Factor
+struct SparseMatrix
+{
+	int n;
+	vector<int> colStart, rows;
+	vector<double> values;
+
+	// y = A x
+	void Multiply(const vector<double> &x, vector<double> &y) const
+	{
+		y.assign(n, 0.0);
+		for (int j = 0; j < n; j++)
+			for (int p = colStart[j]; p < colStart[j + 1]; p++)
+				y[rows[p]] += values[p] * x[j];
+	}
+};
+
+// M / dt^2 + sum_s k_s G_s^T G_s of the cloth, the matrix projective
+// dynamics factors; fixed particles are coupled like free ones, so it stays
+// symmetric without identity rows
+static SparseMatrix ClothMatrix(const ParticleSystem &ps, double dt, double diagonalShift)
+{
+	const int n = ps.ParticleCount();
+	vector<vector<pair<int, double> > > columns(n);
+	for (int i = 0; i < n; i++)
+		columns[i].push_back(make_pair(i, (ps.IsFixed(i) ? 1.0 : 1.0 / ps.invMass[i]) / (dt * dt) + diagonalShift));
+	for (int s = 0; s < ps.SpringCount(); s++)
+	{
+		const int a = ps.springA[s], b = ps.springB[s];
+		const double k = ps.springK[s];
+		columns[a].push_back(make_pair(a, k));
+		columns[b].push_back(make_pair(b, k));
+		columns[a].push_back(make_pair(b, -k));
+		columns[b].push_back(make_pair(a, -k));
+	}
+
+	SparseMatrix A;
+	A.n = n;
+	A.colStart.resize(n + 1);
+	for (int j = 0; j < n; j++)
+	{
+		vector<pair<int, double> > &c = columns[j];
+		sort(c.begin(), c.end());
+		A.colStart[j] = (int)A.rows.size();
+		for (size_t e = 0; e < c.size(); e++)
+		{
+			if (e > 0 && c[e].first == c[e - 1].first)
+				A.values.back() += c[e].second;
+			else
+			{
+				A.rows.push_back(c[e].first);
+				A.values.push_back(c[e].second);
+			}
+		}
+	}
+	A.colStart[n] = (int)A.rows.size();
+	return A;
+}
+
+// |A x - b| / |b|
+static double RelativeResidual(const SparseMatrix &A, const vector<double> &x, const vector<double> &b)
+{
+	vector<double> Ax;
+	A.Multiply(x, Ax);
+	double r = 0.0, nb = 0.0;
+	for (int i = 0; i < A.n; i++)
+	{
+		r += (Ax[i] - b[i]) * (Ax[i] - b[i]);
+		nb += b[i] * b[i];
+	}
+	return sqrt(r / nb);
+}
+
+static int CheckCholesky()
+{
+	bool ok = true;
+	Scene::Config config;
+	config.testcase = Scene::CLOTH;
+	config.xPoints = 12;
+	config.yPoints = 9;
+	config.stiffness = 1e4;
+	ParticleSystem ps;
+	Scene::CreateCloth(ps, config);
+	const double dt = 0.01;
+	const SparseMatrix A = ClothMatrix(ps, dt, 0.0);
+	const int n = A.n;
+
+	vector<int> order;
+	SparseCholesky::MinimumDegreeOrder(n, A.colStart, A.rows, order);
+	vector<int> sorted(order);
+	sort(sorted.begin(), sorted.end());
+	bool permutation = (int)sorted.size() == n;
+	for (int i = 0; permutation && i < n; i++)
+		permutation = sorted[i] == i;
+	ok &= Expect(permutation, "minimum degree order is a permutation of the rows");
+
+	SparseCholesky factor;
+	if (!Expect(factor.Factor(n, A.colStart, A.rows, A.values), "cloth matrix factors"))
+		return EXIT_FAILURE;
+	ok &= Expect(factor.Size() == n, "factor size");
+
+	// right-hand sides of the size of a cloth step
+	vector<double> b0(n), b1(n);
+	srand(1);
+	for (int i = 0; i < n; i++)
+	{
+		b0[i] = (double)rand() / RAND_MAX - 0.5;
+		b1[i] = 1.0 / (dt * dt) * (double)rand() / RAND_MAX;
+	}
+
+	vector<double> x0(b0), x1(b1);
+	factor.Solve(x0.data());
+	factor.Solve(x1.data());
+	const double r0 = RelativeResidual(A, x0, b0), r1 = RelativeResidual(A, x1, b1);
+	cerr << "cholesky: " << n << " rows, " << factor.FactorNonzeros() << " nonzeros in L, residuals " << r0 << ", " << r1 << endl;
+	ok &= Expect(r0 < 1e-10 && r1 < 1e-10, "single solves have a small residual");
+
+	// the interleaved solve runs the same operations on both columns
+	vector<double> y0(b0), y1(b1);
+	factor.Solve(y0.data(), y1.data());
+	ok &= Expect(y0 == x0 && y1 == x1, "two-column solve equals two single solves");
+
+	// shifting the diagonal below zero breaks positive definiteness
+	const SparseMatrix indefinite = ClothMatrix(ps, dt, -1e7);
+	SparseCholesky rejected;
+	ok &= Expect(!rejected.Factor(n, indefinite.colStart, indefinite.rows, indefinite.values), "indefinite matrix is rejected");
+	ok &= Expect(rejected.Size() == 0, "rejected factor is empty");
+
+	// Converged projective dynamics minimizes the implicit Euler energy, the
+	// implicit solver takes one Newton step of it. For a short step from a
+	// stretched cloth the two must agree to well below the displacement.
+	for (int i = 0; i < ps.ParticleCount(); i++)
+		ps.x[i] *= 1.05;
+	ParticleSystem pd(ps), ie(ps);
+	ProjectiveDynamicsSolver projective;
+	projective.iterations = 200;
+	projective.Step(pd, 0.0, 0.001);
+	ImplicitEulerSolver implicit;
+	implicit.Step(ie, 0.0, 0.001);
+	double moved = 0.0, difference = 0.0;
+	for (int i = 0; i < ps.ParticleCount(); i++)
+	{
+		moved = max(moved, hypot(ie.x[i] - ps.x[i], ie.y[i] - ps.y[i]));
+		difference = max(difference, hypot(pd.x[i] - ie.x[i], pd.y[i] - ie.y[i]));
+	}
+	cerr << "cholesky: step moved " << moved << ", projective dynamics differs from implicit Euler by " << difference << endl;
+	ok &= Expect(moved > 0.0 && difference < 0.01 * moved, "projective dynamics step matches implicit Euler");
+
+	// a new spring changes the version, the cached factor must not be reused
+	const int before = projective.Factorization().FactorNonzeros();
+	pd.AddSpring(config.xPoints, n - 1, config.stiffness);
+	projective.Prepare(pd, 0.001);
+	ok &= Expect(projective.Factorization().FactorNonzeros() != before, "projective dynamics refactors after a topology change");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Springs with their own parameters, n not a multiple of the lane width so
+// that the remainder loop runs too, advanced by AdvanceTimeStep1Batch and by
+// the Spring1Run kernels of the spring1d testcase. analytic and
+// adaptive_rk23 are skipped: the batch takes fixed steps from the current
+// state, the scalar kernels do not.
+static int CheckEnsemble()
+{
+	bool ok = true;
+	const int n = 4 * EnsembleLaneWidth() + 3, nSteps = 200;
+	const double dt = 0.003, p1 = 0.0;
+	vector<double> k(n), m(n), d(n), L(n);
+	for (int i = 0; i < n; i++)
+	{
+		k[i] = 5.0 + i;
+		m[i] = 0.1 + 0.01 * i;
+		d[i] = 0.01 * (i % 3);
+		L[i] = 0.5 + 0.1 * i;
+	}
+	cerr << "ensemble: " << EnsembleLaneWidth() << " lanes, " << n << " springs" << endl;
+	for (int method = 1; method < METHODS_NUM; method++)
+	{
+		if (method == Scene::ANALYTIC || method == Scene::ADAPTIVE_RK23)
+			continue;
+		vector<double> p2(n, -1.0), v2(n, 0.0), q2(p2), w2(v2);
+		for (int s = 0; s < nSteps; s++)
+			AdvanceTimeStep1Batch(&k[0], &m[0], &d[0], &L[0], dt, method, p1, &p2[0], &v2[0], n);
+		const Spring1Kernel kernel = SelectKernel<Spring1Run>(method);
+		double difference = 0.0;
+		for (int i = 0; i < n; i++)
+		{
+			Spring1State state(q2[i], w2[i]);
+			kernel(k[i], m[i], d[i], L[i], dt, p1, q2[i], w2[i], nSteps, state);
+			difference = max(difference, max(fabs(p2[i] - q2[i]), fabs(v2[i] - w2[i])));
+		}
+		// the same operations in the same order; with USE_NATIVE_ARCH the
+		// compiler fuses multiply-adds in the scalar path only, and velocities
+		// taken from position differences over dt amplify the last bits
+		cerr << "ensemble: " << methodNames[method] << " differs from the scalar kernel by " << difference << endl;
+		ok &= Expect(difference <= 1e-9, string(methodNames[method]) + ": batch matches the scalar kernel");
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool ReadFile(const string &fileName, vector<char> &data)
+{
+	FILE *file = fopen(fileName.c_str(), "rb");
+	if (!file)
+		return false;
+	data.clear();
+	char block[65536];
+	size_t n;
+	while ((n = fread(block, 1, sizeof(block), file)) > 0)
+		data.insert(data.end(), block, block + n);
+	fclose(file);
+	return true;
+}
+
+// Runs config for its steps, resets and runs again. The trajectories of
+// both runs go to separate files that must be identical.
+static bool CheckResetOf(Scene::Config config, const string &name)
+{
+	bool ok = true;
+	const string first = "selfcheck_reset_" + name + "_1.bin";
+	const string second = "selfcheck_reset_" + name + "_2.bin";
+	config.headless = true;
+	config.numThreads = 1;
+	config.outFile = first;
+	config.outDouble = true;
+	Scene scene(config);
+	for (int s = 0; s < config.numSteps; s++)
+		scene.Update();
+
+	scene.config.outFile = second;
+	// the first run stored everything it needs, the rerun allocates nothing
+	allocations = 0;
+	countAllocations = true;
+	scene.Reset();
+	for (int s = 0; s < config.numSteps; s++)
+		scene.Update();
+	countAllocations = false;
+	ok &= Expect(scene.CloseOutput(), name + ": trajectory written");
+	const long rerunAllocations = allocations;
+
+	vector<char> a, b;
+	ok &= Expect(ReadFile(first, a) && ReadFile(second, b), name + ": trajectories readable");
+	ok &= Expect(!a.empty() && a == b, name + ": rerun reproduces the trajectory (" + to_string(a.size()) + " and " + to_string(b.size()) + " bytes)");
+	ok &= Expect(rerunAllocations == 0, name + ": rerun allocates " + to_string(rerunAllocations) + " times");
+	remove(first.c_str());
+	remove(second.c_str());
+	return ok;
+}
+
+// Runs config, switches to other, resets and runs again. The rerun must
+// match a fresh scene of other, so nothing built for the first network may be
+// reused for a second one with as many particles and springs.
+static bool CheckResetToOther(Scene::Config config, const Scene::Config &other, const string &name)
+{
+	bool ok = true;
+	const string reset = "selfcheck_reset_" + name + "_reset.bin";
+	const string fresh = "selfcheck_reset_" + name + "_fresh.bin";
+	config.headless = true;
+	config.numThreads = 1;
+	config.outDouble = true;
+	Scene scene(config);
+	for (int s = 0; s < config.numSteps; s++)
+		scene.Update();
+
+	scene.config = other;
+	scene.config.headless = true;
+	scene.config.numThreads = 1;
+	scene.config.outDouble = true;
+	scene.config.outFile = reset;
+	scene.Reset();
+	for (int s = 0; s < other.numSteps; s++)
+		scene.Update();
+	ok &= Expect(scene.CloseOutput(), name + ": trajectory written");
+
+	Scene::Config freshConfig = scene.config;
+	freshConfig.outFile = fresh;
+	{
+		Scene second(freshConfig);
+		for (int s = 0; s < other.numSteps; s++)
+			second.Update();
+		ok &= Expect(second.CloseOutput(), name + ": fresh trajectory written");
+	}
+
+	vector<char> a, b;
+	ok &= Expect(ReadFile(reset, a) && ReadFile(fresh, b), name + ": trajectories readable");
+	ok &= Expect(!a.empty() && a == b, name + ": reset to another network matches a fresh scene");
+	remove(reset.c_str());
+	remove(fresh.c_str());
+	return ok;
+}
+
+// Cloth of config advanced to time T with steps of dt by method
+static void RunNetwork(const Scene::Config &config, Scene::Method method, double dt, double T, ParticleSystem &ps)
+{
+	ps.Clear();
+	Scene::CreateCloth(ps, config);
+	ExplicitSolver solver;
+	const int nSteps = (int)(T / dt + 0.5);
+	for (int s = 0; s < nSteps; s++)
+	{
+		if (method == Scene::BACK_EULER)
+			AdvanceTimeStep3(config.damping, dt, ps);
+		else
+			solver.Step(ps, method, config.damping, dt);
+	}
+}
+
+// Largest position difference of two runs
+static double MaxDistance(const ParticleSystem &a, const ParticleSystem &b)
+{
+	double distance = 0.0;
+	for (int i = 0; i < a.ParticleCount(); i++)
+		distance = max(distance, hypot(a.x[i] - b.x[i], a.y[i] - b.y[i]));
+	return distance;
+}
+
+static int CheckNetworkMethods()
+{
+	bool ok = true;
+	Scene::Config config;
+	config.testcase = Scene::CLOTH;
+	config.xPoints = config.yPoints = 5;
+	config.mass = 0.1;
+	config.stiffness = 10.0;
+	config.damping = 0.01;
+	// short enough that the cloth does not reach the ground
+	const double T = 0.4, dt = 0.01;
+	ParticleSystem reference;
+	RunNetwork(config, Scene::RK4, dt / 32, T, reference);
+
+	const Scene::Method methods[6] = { Scene::EULER, Scene::LEAP_FROG, Scene::MIDPOINT, Scene::BACK_EULER, Scene::RK4, Scene::VELOCITY_VERLET };
+	const double orders[6] = { 1.0, 1.0, 2.0, 1.0, 4.0, 2.0 };
+	ParticleSystem runs[6], fine;
+	for (int m = 0; m < 6; m++)
+	{
+		const string name = methodNames[methods[m]];
+		ok &= Expect(Scene::Supports(Scene::CLOTH, methods[m]), name + " runs on the cloth");
+		RunNetwork(config, methods[m], dt, T, runs[m]);
+		RunNetwork(config, methods[m], dt / 2, T, fine);
+		const double coarseError = MaxDistance(runs[m], reference), fineError = MaxDistance(fine, reference);
+		const double order = log(coarseError / fineError) / log(2.0);
+		cerr << "network_methods: " << name << " error " << coarseError << ", order " << order << endl;
+		ok &= Expect(order > orders[m] - 0.3, name + " converges with order " + to_string(orders[m]));
+		for (int o = 0; o < m; o++)
+			ok &= Expect(MaxDistance(runs[m], runs[o]) > 0.0, name + " differs from " + methodNames[methods[o]]);
+	}
+	ok &= Expect(!Scene::Supports(Scene::CLOTH, Scene::ANALYTIC) && !Scene::Supports(Scene::FALLING, Scene::ANALYTIC),
+		"analytic is refused on spring networks");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int CheckReset()
+{
+	bool ok = true;
+	int scenes = 0;
+	Scene::Config config;
+	config.numSteps = 200;
+	config.testcase = Scene::SPRING1D;
+	for (int m = Scene::EULER; m < METHODS_NUM; m++)
+	{
+		config.method = (Scene::Method)m;
+		ok &= CheckResetOf(config, string("spring1d_") + methodNames[m]);
+		scenes++;
+	}
+	config.testcase = Scene::CLOTH;
+	config.xPoints = config.yPoints = 8;
+	config.mass = 0.1;
+	for (int m = Scene::EULER; m < METHODS_NUM; m++)
+	{
+		config.method = (Scene::Method)m;
+		if (!Scene::Supports(config.testcase, config.method))
+			continue;
+		ok &= CheckResetOf(config, string("cloth_") + methodNames[m]);
+		scenes++;
+	}
+	// colored for the parallel spring forces, the reset keeps the colors
+	config.xPoints = config.yPoints = 70;
+	config.numSteps = 5;
+	config.method = Scene::BACK_EULER;
+	ParticleSystem large;
+	Scene::CreateCloth(large, config);
+	ok &= Expect(large.SpringCount() >= ParticleSystem::parallelSprings, "the large cloth has its springs colored");
+	ok &= CheckResetOf(config, "cloth_colored");
+	scenes++;
+
+	// a 4 x 6 and a 6 x 4 cloth have the same particle and spring counts
+	config.numSteps = 50;
+	Scene::Config other = config;
+	config.xPoints = 4;
+	config.yPoints = 6;
+	other.xPoints = 6;
+	other.yPoints = 4;
+	for (Scene::Method m : { Scene::IMPLICIT_EULER, Scene::PROJECTIVE_DYNAMICS })
+	{
+		config.method = other.method = m;
+		ok &= CheckResetToOther(config, other, string("cloth_other_") + methodNames[m]);
+		scenes++;
+	}
+	cerr << "reset: " << scenes << " scenes run, reset and run again" << endl;
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#ifdef HAVE_EGL
+// OpenGL context drawing into a pbuffer, without a window system
+class OffscreenContext
+{
+public:
+	OffscreenContext(void) : display(EGL_NO_DISPLAY), surface(EGL_NO_SURFACE), context(EGL_NO_CONTEXT) {}
+	~OffscreenContext(void)
+	{
+		if (display == EGL_NO_DISPLAY)
+			return;
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (context != EGL_NO_CONTEXT)
+			eglDestroyContext(display, context);
+		if (surface != EGL_NO_SURFACE)
+			eglDestroySurface(display, surface);
+		eglTerminate(display);
+	}
+
+	// Makes a width x height RGB context current on the calling thread.
+	// Prefers the surfaceless Mesa platform, which needs no X server.
+	bool Create(int width, int height)
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+		if (getPlatformDisplay)
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+#endif
+		if (display == EGL_NO_DISPLAY)
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		EGLint major, minor;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+		{
+			display = EGL_NO_DISPLAY;
+			return false;
+		}
+
+		const EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8,
+			EGL_BLUE_SIZE, 8, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		const EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+		EGLConfig config;
+		EGLint nConfigs = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &nConfigs) || nConfigs < 1)
+			return false;
+		surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+		if (surface == EGL_NO_SURFACE || !eglBindAPI(EGL_OPENGL_API))
+			return false;
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+		return context != EGL_NO_CONTEXT && eglMakeCurrent(display, surface, surface, context);
+	}
+
+private:
+	EGLDisplay display;
+	EGLSurface surface;
+	EGLContext context;
+};
+
+// Pixels of the frame buffer close to the given color
+static int CountPixels(const vector<unsigned char> &rgba, int r, int g, int b)
+{
+	int count = 0;
+	for (size_t p = 0; p < rgba.size(); p += 4)
+		if (abs(rgba[p] - r) < 40 && abs(rgba[p + 1] - g) < 40 && abs(rgba[p + 2] - b) < 40)
+			count++;
+	return count;
+}
+
+static int CheckRender()
+{
+	const int size = 512;
+	OffscreenContext gl;
+	if (!gl.Create(size, size))
+	{
+		cerr << "render: no offscreen OpenGL context, skipped" << endl;
+		return skipStatus;
+	}
+	cerr << "render: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << endl;
+
+	bool ok = true;
+	Scene::Config config;
+	config.testcase = Scene::CLOTH;
+	config.method = Scene::XPBD;
+	config.xPoints = config.yPoints = 8;
+	// wide enough that the springs show between the points
+	config.xSize = config.ySize = 2.0;
+	config.numThreads = 1;
+	Scene scene(config);
+	for (int s = 0; s < 10; s++)
+		scene.Update();
+
+	// the frame of display() in main.cpp
+	glViewport(0, 0, size, size);
+	glEnable(GL_LINE_SMOOTH);
+	glClearColor(0, 0, 0, 1);
+	glClear(GL_COLOR_BUFFER_BIT);
+	scene.Render();
+	glFinish();
+	const GLenum error = glGetError();
+	ok &= Expect(error == GL_NO_ERROR, "render: GL error " + to_string(error));
+
+	vector<unsigned char> rgba(4 * size * size);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+	const int springs = CountPixels(rgba, 128, 128, 128);
+	const int red = CountPixels(rgba, 255, 0, 0);
+	const int blue = CountPixels(rgba, 0, 0, 255);
+	cerr << "render: " << springs << " spring, " << red << " red and " << blue << " blue point pixels" << endl;
+	ok &= Expect(springs > 0, "render: springs drawn");
+	ok &= Expect(red > 0 && blue > 0, "render: points drawn in their colors");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+#endif
+
+static int CheckScheduler()
+{
+	typedef StepScheduler::Clock Clock;
+	typedef std::chrono::milliseconds ms;
+	bool ok = true;
+	const Clock::time_point t0;
+	StepScheduler scheduler(ms(10), 4);
+	scheduler.Start(t0);
+	ok &= Expect(scheduler.Advance(t0 + ms(5)) == 0, "scheduler: no step before one is due");
+	ok &= Expect(scheduler.UntilNextStep() == ms(5), "scheduler: waits for the rest of the step");
+	ok &= Expect(scheduler.Advance(t0 + ms(35)) == 3, "scheduler: catches up with the elapsed steps");
+	ok &= Expect(scheduler.UntilNextStep() == ms(5), "scheduler: keeps the remainder");
+	ok &= Expect(scheduler.Advance(t0 + ms(40)) == 1, "scheduler: remainder counts towards the next step");
+
+	// a stall of a second runs at most maxSubsteps and drops the rest but one
+	ok &= Expect(scheduler.Advance(t0 + ms(1040)) == 4, "scheduler: at most maxSubsteps per call");
+	ok &= Expect(scheduler.UntilNextStep() == Clock::duration(0), "scheduler: a step is due after a stall");
+	ok &= Expect(scheduler.Advance(t0 + ms(1040)) == 1, "scheduler: backlog dropped after one step");
+	ok &= Expect(scheduler.Advance(t0 + ms(1045)) == 0, "scheduler: back on schedule");
+
+	StepScheduler zero(Clock::duration(0), 0);
+	ok &= Expect(zero.Step() > Clock::duration(0), "scheduler: zero step raised to one tick");
+
+	// 60 fps frame deadlines
+	const Clock::duration frame = ms(16);
+	ok &= Expect(StepScheduler::NextDeadline(t0, frame, t0 + ms(3)) == t0 + ms(16), "scheduler: next frame one period later");
+	ok &= Expect(StepScheduler::NextDeadline(t0, frame, t0 + ms(50)) == t0 + ms(66), "scheduler: late frame timer restarts from now");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int CheckSimulationThread()
+{
+	typedef StepScheduler::Clock Clock;
+	bool ok = true;
+	Scene::Config config;
+	config.testcase = Scene::CLOTH;
+	config.method = Scene::XPBD;
+	config.xPoints = config.yPoints = 8;
+	config.numThreads = 1;
+	config.step = 0.005;
+	Scene scene(config);
+
+#ifdef HAVE_EGL
+	OffscreenContext gl;
+	const bool draw = gl.Create(64, 64);
+#else
+	const bool draw = false;
+#endif
+	if (!draw)
+		cerr << "simulation_thread: no offscreen OpenGL context, the scene is not drawn" << endl;
+
+	// draw at about 60 fps for a quarter second while the thread steps
+	SimulationThread thread;
+	const int maxSubsteps = 10;
+	const Clock::time_point start = Clock::now();
+	thread.Start(scene, maxSubsteps);
+	int frames = 0;
+	while (Clock::now() - start < std::chrono::milliseconds(250))
+	{
+#ifdef HAVE_EGL
+		if (draw)
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			scene.Render();
+			glFinish();
+		}
+#endif
+		frames++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(16));
+	}
+	const Clock::time_point stopping = Clock::now();
+	thread.Stop();
+	const std::chrono::duration<double> elapsed = Clock::now() - start;
+	const std::chrono::duration<double> stopTime = Clock::now() - stopping;
+	const long steps = thread.Steps();
+
+	cerr << "simulation_thread: " << steps << " steps and " << frames << " frames in " << elapsed.count() << " s, stopped in " << stopTime.count() << " s" << endl;
+	ok &= Expect(steps > 0, "simulation_thread: the scene advanced");
+	// the schedule never runs ahead of the wall clock
+	ok &= Expect(steps <= elapsed.count() / config.step + 1, "simulation_thread: no more steps than elapsed time");
+	ok &= Expect(stopTime.count() < 1.0, "simulation_thread: Stop joins promptly");
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	ok &= Expect(thread.Steps() == steps, "simulation_thread: no steps after Stop");
+#ifdef HAVE_EGL
+	if (draw)
+		ok &= Expect(glGetError() == GL_NO_ERROR, "simulation_thread: drawing without GL errors");
+#endif
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+struct Check
+{
+	const char *name;
+	// EXIT_SUCCESS, EXIT_FAILURE or skipStatus
+	int (*run)();
+};
+
+static const Check checks[] =
+{
+	{ "cholesky", CheckCholesky },
+	{ "ensemble", CheckEnsemble },
+	{ "network_methods", CheckNetworkMethods },
+	{ "reset", CheckReset },
+#ifdef HAVE_EGL
+	{ "render", CheckRender },
+#endif
+	{ "scheduler", CheckScheduler },
+	{ "simulation_thread", CheckSimulationThread },
+};
+
+int main(int argc, char** argv)
+{
+	const int nChecks = (int)(sizeof(checks) / sizeof(checks[0]));
+	if (argc == 2)
+	{
+		for (int i = 0; i < nChecks; i++)
+			if (!strcmp(argv[1], checks[i].name))
+				return checks[i].run();
+	}
+	cerr << "Usage: selfcheck <check>" << endl << "Checks:" << endl;
+	for (int i = 0; i < nChecks; i++)
+		cerr << "\t" << checks[i].name << endl;
+	return EXIT_FAILURE;
+}